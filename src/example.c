@@ -118,8 +118,7 @@ int test_range_checks() {
     int value = 50;
     TEST_ASSERT_IN_RANGE(value, 1, 100, "Value should be between 1 and 100");
     
-    // Test with random values
-    srand(time(NULL));
+    // Test with random values (seeded from GS_SEED or the clock; failures print the seed)
     int random_val = RANDOM_INT(10, 20);
     LOG_VAR(random_val);
     TEST_ASSERT_IN_RANGE(random_val, 10, 20, "Random value should be in specified range");
@@ -137,6 +136,10 @@ int test_crash_scenarios() {
     // Test expected crash from null pointer access
     TEST_EXPECT_CRASH({access_null_pointer();}, "Null pointer access should crash");
     
+    // Expect the exact exit status and the CHECK message, not just any crash
+    TEST_EXPECT_EXIT({divide_by_zero();}, EXIT_FAILURE, "Division by zero check should exit with failure");
+    TEST_EXPECT_CRASH_OUTPUT({divide_by_zero();}, "Division by zero", "Division by zero check should explain itself");
+    
     return 1;
 }
 
@@ -223,6 +226,22 @@ int test_stress_scenarios() {
     return 1;
 }
 
+// Property-based testing example
+int prop_multiply_commutes(gs_prop_t *p) {
+    int a = (int)PROP_INT(p, "a", -10000, 10000);
+    int b = (int)PROP_INT(p, "b", -10000, 10000);
+    return multiply(a, b) == multiply(b, a);
+}
+
+int test_properties() {
+    TRACE_FUNCTION();
+    
+    // Generates 10000 (a, b) pairs; a failure would be shrunk and printed with the seed
+    PROPERTY_TEST(prop_multiply_commutes, 10000, "Multiplication should commute");
+    
+    return 1;
+}
+
 // Buffer overflow testing
 int test_buffer_security() {
     TRACE_FUNCTION();
@@ -262,7 +281,7 @@ int test_with_setup_teardown() {
     
     TEST_SETUP({
         printf("  Initializing test data...\n");
-        srand(42); // Fixed seed for reproducible tests
+        RANDOM_SEED(42); // Fixed seed for reproducible tests
     });
     
     // The actual test
@@ -303,7 +322,8 @@ int main() {
     printf("Environment variables you can set:\n");
     printf("  DEBUG=1     - Enable debug output\n");
     printf("  TRACE=1     - Enable function tracing\n");
-    printf("  SKIP_SLOW_TESTS=1 - Skip slow tests\n\n");
+    printf("  SKIP_SLOW_TESTS=1 - Skip slow tests\n");
+    printf("  GS_PROFILE=1 - Profile benchmarks and slow tests\n\n");
     
     // Overall benchmark
     BENCHMARK_START();
@@ -317,7 +337,8 @@ int main() {
     RUN_TEST(test_memory_management);
     RUN_TEST(test_file_operations);
     RUN_TEST(test_performance);
-    RUN_TEST(test_stress_scenarios);
+    RUN_SLOW_TEST(test_stress_scenarios);
+    RUN_TEST(test_properties);
     RUN_TEST(test_buffer_security);
     RUN_TEST(test_conditional_features);
     RUN_TEST(test_with_setup_teardown);
@@ -340,34 +361,63 @@ int main() {
 /*
 SETTING ENVIRONMENTAL VARIABLES
 - DEBUG=1 TRACE=1 ./example
+- GS_UPDATE_SNAPSHOTS=1 ./example                  - Rewrite differing snapshots
+- GS_REPORT=report.json ./example                  - Write per-test resource usage as JSON
+- GS_TRACE_FILE=trace.json ./example               - Record spans and write a Chrome trace at exit
+- GS_PROFILE=1 ./example                           - CPU-profile benchmarks and slow tests
+
+COMPILE OPTIONS
+- -DGLITCHSNITCH_QUIET_PASS                          - Count passing assertions instead of printing them
 
 BASIC TESTING MACROS:
 - TEST_ASSERT(condition, message)                    - Basic assertion
-- TEST_ASSERT_EQ(actual, expected, message)          - Equality with detailed output
+- TEST_ASSERT_EQ(actual, expected, message)          - Type-generic equality with detailed output
 - TEST_ASSERT_STR_EQ(actual, expected, message)      - String comparison
 - TEST_ASSERT_NOT_NULL(ptr, message)                 - Null pointer check
 - TEST_ASSERT_NULL(ptr, message)                     - Verify pointer is null
 - RUN_TEST(test_func)                                - Run test and track results
 - TEST_EXPECT_CRASH(code, message)                   - Test for expected crashes
+- TEST_EXPECT_SIGNAL(code, signo, message)           - Expect death by a specific signal
+- TEST_EXPECT_EXIT(code, status, message)            - Expect a specific exit status
+- TEST_EXPECT_CRASH_OUTPUT(code, text, message)      - Expect a crash whose stderr contains text
 
 ADVANCED TESTING MACROS:
 - TEST_ASSERT_ARRAY_EQ(actual, expected, size, msg)  - Array comparison
 - TEST_ASSERT_FLOAT_EQ(actual, expected, epsilon, msg) - Float comparison
+- TEST_ASSERT_FLOAT_ARRAY_EQ(a, e, size, epsilon, msg) - Float/double array comparison, absolute tolerance
+- TEST_ASSERT_FLOAT_ARRAY_ULP(a, e, size, ulps, msg)  - Float/double array comparison, ULP tolerance
 - TEST_ASSERT_IN_RANGE(value, min, max, message)     - Range validation
 - TEST_SETUP(code) / TEST_TEARDOWN(code)             - Test initialization/cleanup
+- SUITE_SETUP(code) / SUITE_TEARDOWN(code)           - Build/release state shared by a suite
+- RUN_SUITE_TEST(test_func)                          - Run test in a fork of the suite state
+- RUN_SLOW_TEST(test_func)                           - Run test, CPU-profiled when GS_PROFILE is set
+- FIXTURE_GET(name, source, build_fn, &len)         - Shared read-only fixture, built once
+- FIXTURE_GET_VERSION(name, source, fn, v, &len)    - Same, rebuilt when the build version changes
 - TEST_SKIP(condition, message)                      - Conditional test skipping
 - TEST_FILE_EXISTS(filepath, message)                - File existence check
+- TEST_ASSERT_FILE_EQ(actual, expected, message)     - Compare a file against a golden file
+- TEST_ASSERT_SNAPSHOT(buffer, len, name)           - Compare a buffer against snapshots/name
 - TEST_BUFFER_OVERFLOW(buffer, size, write_size, msg) - Buffer overflow check
 
 PERFORMANCE MACROS:
 - BENCHMARK_START() / BENCHMARK_END(name)            - Performance measurement
+- PROFILE_START() / PROFILE_STOP(name)               - Sampling CPU profile to name.folded
 - REPEAT_TEST(n, code)                               - Repeat test operations
 - STRESS_TEST(iterations, code, message)             - Stress testing
+- SOAK_TEST(seconds, code, message)                  - Time-bounded stress test with live throughput
+- REPEAT_FOR(seconds, code)                          - Repeat test operations for a duration
+- CONCURRENT_STRESS_TEST(threads, n, body, inv, msg) - Multi-threaded stress test + invariant
+- STRESS_YIELD()                                     - Interleaving point for concurrent stress tests
+- PROPERTY_TEST(property, iterations, message)       - Property test with shrinking (PROP_* generators)
+- FUZZ_TEST(name, data, size) { ... }                - Coverage-guided fuzz target / corpus replay
 
 MEMORY MACROS:
 - MALLOC_COUNT_START()                               - Initialize memory tracking
 - TRACK_MALLOC(ptr) / TRACK_FREE(ptr)               - Track allocations
 - CHECK_MEMORY_LEAKS()                              - Check for leaks
+- TEST_ALLOC_FAILURES(test_func, max_points, msg)    - Fail each allocation in turn
+- ALLOC_FAIL_AT(n) / ALLOC_FAIL_RATE(rate)           - Fail the nth / a random share of allocations
+- HEAP_PROFILE_START(bytes) / HEAP_PROFILE_DUMP(path) - Sampled live heap by call site
 
 CHECKING MACROS:
 - CHECK(condition, msg)                              - Fatal assertion
@@ -379,14 +429,19 @@ CHECKING MACROS:
 
 DEBUGGING MACROS:
 - DEBUG_PRINT(fmt, ...)                              - Conditional debug output
-- TRACE_FUNCTION()                                   - Function entry tracing
+- TRACE_FUNCTION()                                   - Function entry/exit tracing and timeline span
+- TRACE_SCOPE(name)                                  - Timeline span for the enclosing block
+- TRACE_ENTER()                                      - Entry-only trace line, usable as a statement
+- TRACE_START() / TRACE_EXPORT(path)                 - Record spans / write Chrome trace JSON
 - LOG_VAR(var)                                       - Variable value logging
 - WARN(condition, msg)                               - Non-fatal warnings
 
 UTILITY MACROS:
 - RANDOM_INT(min, max)                               - Random integer generation
 - RANDOM_FLOAT()                                     - Random float generation
-- PRINT_TEST_SUMMARY()                               - Test results summary
+- RANDOM_DOUBLE() / RANDOM_SEED(seed)                - Random double / reseed every thread
+- RANDOM_FILL(buf, size) / RANDOM_FILL_DOUBLE(buf, n) - Bulk random fixtures
+- PRINT_TEST_SUMMARY()                               - Test results summary with the 10 slowest tests
 - ASSERT_UNREACHABLE(msg)                            - Mark unreachable code
 - STATIC_ASSERT(condition, msg)                      - Compile-time assertion
 */
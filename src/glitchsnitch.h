@@ -26,34 +26,63 @@
 /*
 SETTING ENVIRONMENTAL VARIABLES
 - DEBUG=1 TRACE=1 ./example
+- GS_UPDATE_SNAPSHOTS=1 ./example                  - Rewrite differing snapshots
+- GS_REPORT=report.json ./example                  - Write per-test resource usage as JSON
+- GS_TRACE_FILE=trace.json ./example               - Record spans and write a Chrome trace at exit
+- GS_PROFILE=1 ./example                           - CPU-profile benchmarks and slow tests
+
+COMPILE OPTIONS
+- -DGLITCHSNITCH_QUIET_PASS                          - Count passing assertions instead of printing them
 
 BASIC TESTING MACROS:
 - TEST_ASSERT(condition, message)                    - Basic assertion
-- TEST_ASSERT_EQ(actual, expected, message)          - Equality with detailed output
+- TEST_ASSERT_EQ(actual, expected, message)          - Type-generic equality with detailed output
 - TEST_ASSERT_STR_EQ(actual, expected, message)      - String comparison
 - TEST_ASSERT_NOT_NULL(ptr, message)                 - Null pointer check
 - TEST_ASSERT_NULL(ptr, message)                     - Verify pointer is null
 - RUN_TEST(test_func)                                - Run test and track results
 - TEST_EXPECT_CRASH(code, message)                   - Test for expected crashes
+- TEST_EXPECT_SIGNAL(code, signo, message)           - Expect death by a specific signal
+- TEST_EXPECT_EXIT(code, status, message)            - Expect a specific exit status
+- TEST_EXPECT_CRASH_OUTPUT(code, text, message)      - Expect a crash whose stderr contains text
 
 ADVANCED TESTING MACROS:
 - TEST_ASSERT_ARRAY_EQ(actual, expected, size, msg)  - Array comparison
 - TEST_ASSERT_FLOAT_EQ(actual, expected, epsilon, msg) - Float comparison
+- TEST_ASSERT_FLOAT_ARRAY_EQ(a, e, size, epsilon, msg) - Float/double array comparison, absolute tolerance
+- TEST_ASSERT_FLOAT_ARRAY_ULP(a, e, size, ulps, msg)  - Float/double array comparison, ULP tolerance
 - TEST_ASSERT_IN_RANGE(value, min, max, message)     - Range validation
 - TEST_SETUP(code) / TEST_TEARDOWN(code)             - Test initialization/cleanup
+- SUITE_SETUP(code) / SUITE_TEARDOWN(code)           - Build/release state shared by a suite
+- RUN_SUITE_TEST(test_func)                          - Run test in a fork of the suite state
+- RUN_SLOW_TEST(test_func)                           - Run test, CPU-profiled when GS_PROFILE is set
+- FIXTURE_GET(name, source, build_fn, &len)         - Shared read-only fixture, built once
+- FIXTURE_GET_VERSION(name, source, fn, v, &len)    - Same, rebuilt when the build version changes
 - TEST_SKIP(condition, message)                      - Conditional test skipping
 - TEST_FILE_EXISTS(filepath, message)                - File existence check
+- TEST_ASSERT_FILE_EQ(actual, expected, message)     - Compare a file against a golden file
+- TEST_ASSERT_SNAPSHOT(buffer, len, name)           - Compare a buffer against snapshots/name
 - TEST_BUFFER_OVERFLOW(buffer, size, write_size, msg) - Buffer overflow check
 
 PERFORMANCE MACROS:
 - BENCHMARK_START() / BENCHMARK_END(name)            - Performance measurement
+- PROFILE_START() / PROFILE_STOP(name)               - Sampling CPU profile to name.folded
 - REPEAT_TEST(n, code)                               - Repeat test operations
 - STRESS_TEST(iterations, code, message)             - Stress testing
+- SOAK_TEST(seconds, code, message)                  - Time-bounded stress test with live throughput
+- REPEAT_FOR(seconds, code)                          - Repeat test operations for a duration
+- CONCURRENT_STRESS_TEST(threads, n, body, inv, msg) - Multi-threaded stress test + invariant
+- STRESS_YIELD()                                     - Interleaving point for concurrent stress tests
+- PROPERTY_TEST(property, iterations, message)       - Property test with shrinking (PROP_* generators)
+- FUZZ_TEST(name, data, size) { ... }                - Coverage-guided fuzz target / corpus replay
 
 MEMORY MACROS:
 - MALLOC_COUNT_START()                               - Initialize memory tracking
 - TRACK_MALLOC(ptr) / TRACK_FREE(ptr)               - Track allocations
 - CHECK_MEMORY_LEAKS()                              - Check for leaks
+- TEST_ALLOC_FAILURES(test_func, max_points, msg)    - Fail each allocation in turn
+- ALLOC_FAIL_AT(n) / ALLOC_FAIL_RATE(rate)           - Fail the nth / a random share of allocations
+- HEAP_PROFILE_START(bytes) / HEAP_PROFILE_DUMP(path) - Sampled live heap by call site
 
 CHECKING MACROS:
 - CHECK(condition, msg)                              - Fatal assertion
@@ -65,14 +94,19 @@ CHECKING MACROS:
 
 DEBUGGING MACROS:
 - DEBUG_PRINT(fmt, ...)                              - Conditional debug output
-- TRACE_FUNCTION()                                   - Function entry tracing
+- TRACE_FUNCTION()                                   - Function entry/exit tracing and timeline span
+- TRACE_SCOPE(name)                                  - Timeline span for the enclosing block
+- TRACE_ENTER()                                      - Entry-only trace line, usable as a statement
+- TRACE_START() / TRACE_EXPORT(path)                 - Record spans / write Chrome trace JSON
 - LOG_VAR(var)                                       - Variable value logging
 - WARN(condition, msg)                               - Non-fatal warnings
 
 UTILITY MACROS:
 - RANDOM_INT(min, max)                               - Random integer generation
 - RANDOM_FLOAT()                                     - Random float generation
-- PRINT_TEST_SUMMARY()                               - Test results summary
+- RANDOM_DOUBLE() / RANDOM_SEED(seed)                - Random double / reseed every thread
+- RANDOM_FILL(buf, size) / RANDOM_FILL_DOUBLE(buf, n) - Bulk random fixtures
+- PRINT_TEST_SUMMARY()                               - Test results summary with the 10 slowest tests
 - ASSERT_UNREACHABLE(msg)                            - Mark unreachable code
 - STATIC_ASSERT(condition, msg)                      - Compile-time assertion
 */
@@ -80,9 +114,17 @@ UTILITY MACROS:
 
 #pragma once
 
+/// ? fork(), mmap() and friends need the POSIX/GNU declarations even under -std=c11. The define
+/// ? below only takes effect when this header comes before every system header, so build with
+/// ? -D_GNU_SOURCE (the CMake target adds it) if a test file includes anything else first.
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include <error.h>  
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -90,6 +132,43 @@ UTILITY MACROS:
 #include <time.h>
 #include <unistd.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/syscall.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <math.h>
+#include <signal.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+
+#if defined(__GLIBC__) && !defined(_POSIX_C_SOURCE)
+#error "glitchsnitch.h needs POSIX declarations: compile with -D_GNU_SOURCE or include it before any system header"
+#endif
+
+/// ? Without _GNU_SOURCE glibc hides dladdr() and RUSAGE_THREAD: addresses are then printed as
+/// ? numbers, and per-test usage is measured for the whole process instead of the test's thread.
+#if defined(__GLIBC__) && !defined(__USE_GNU)
+#define GS_HAVE_DLADDR 0
+#else
+#define GS_HAVE_DLADDR 1
+#endif
+
+#ifdef RUSAGE_THREAD
+#define GS_RUSAGE_TEST RUSAGE_THREAD
+#else
+#define GS_RUSAGE_TEST RUSAGE_SELF
+#endif
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
 
 
 /*
@@ -125,7 +204,7 @@ In your test file
 int test_advanced_features() {
     TEST_SETUP({
         Initialize test data
-        srand(time(NULL));
+        RANDOM_SEED(42);
     });
     
     Array testing
@@ -193,54 +272,669 @@ typedef enum
 } err_type_t;
 
 
+// Assertions
+//
+// Passing assertions cost one predicted branch and a counter increment. Operands are evaluated
+// exactly once into locals and compared by kind (selected with _Generic), so mixed signed/unsigned
+// comparisons are exact and no value is truncated through an int cast. Only when a check fails are
+// the operands captured into the preallocated failure record gs_last_failure and handed to a cold,
+// out-of-line function that formats them, keeping the formatting code out of hot loops.
+//
+// Define GLITCHSNITCH_QUIET_PASS before including this header to count passing assertions instead
+// of printing a PASS line for each; PRINT_TEST_SUMMARY reports the count either way.
+
+/// ? The wrappers are forced inline so heap profiler stacks start at the caller, not in here
+#define GS_ALWAYS_INLINE inline __attribute__((always_inline))
+#define GS_COLD          __attribute__((cold, noinline))
+#define GS_UNLIKELY(x)   __builtin_expect(!!(x), 0)
+
+static long gs_assertions_passed = 0;
+
+#ifdef GLITCHSNITCH_QUIET_PASS
+#define GS_PASS(...) ((void)gs_assertions_passed++)
+#else
+#define GS_PASS(...) ((void)gs_assertions_passed++, (void)printf("PASS: " __VA_ARGS__))
+#endif
+
+/// ? Value kinds used to pick a comparison and to print operands
+typedef enum
+{
+    GS_KIND_SIGNED,
+    GS_KIND_UNSIGNED,
+    GS_KIND_FLOAT,
+    GS_KIND_DOUBLE,
+    GS_KIND_LONG_DOUBLE,
+    GS_KIND_OTHER,      /// ? pointers; array elements of other types are printed as raw bytes
+} gs_kind_t;
+
+#define GS_KIND_OF(x)                                                                                      \
+    _Generic((x),                                                                                          \
+        _Bool: GS_KIND_UNSIGNED, char: ((char)-1 < 0 ? GS_KIND_SIGNED : GS_KIND_UNSIGNED),                 \
+        signed char: GS_KIND_SIGNED, short: GS_KIND_SIGNED, int: GS_KIND_SIGNED,                           \
+        long: GS_KIND_SIGNED, long long: GS_KIND_SIGNED,                                                   \
+        unsigned char: GS_KIND_UNSIGNED, unsigned short: GS_KIND_UNSIGNED, unsigned int: GS_KIND_UNSIGNED,  \
+        unsigned long: GS_KIND_UNSIGNED, unsigned long long: GS_KIND_UNSIGNED,                             \
+        float: GS_KIND_FLOAT, double: GS_KIND_DOUBLE, long double: GS_KIND_LONG_DOUBLE,                    \
+        default: GS_KIND_OTHER)
+
+#define GS_KIND_IS_FLOATING(kind) ((kind) == GS_KIND_FLOAT || (kind) == GS_KIND_DOUBLE || (kind) == GS_KIND_LONG_DOUBLE)
+
+/// ? An operand captured by value, tagged with the kind of its original type. `v` is a struct rather
+/// ? than a union because passing a union holding a long double makes GCC print an ABI note.
+typedef struct
+{
+    gs_kind_t kind;
+    struct
+    {
+        long long          s;
+        unsigned long long u;
+        long double        f;
+        const void        *p;
+    } v;
+} gs_value_t;
+
+static GS_ALWAYS_INLINE gs_value_t gs_value_signed(long long x)        { gs_value_t r = {0}; r.kind = GS_KIND_SIGNED; r.v.s = x; return r; }
+static GS_ALWAYS_INLINE gs_value_t gs_value_unsigned(unsigned long long x) { gs_value_t r = {0}; r.kind = GS_KIND_UNSIGNED; r.v.u = x; return r; }
+static GS_ALWAYS_INLINE gs_value_t gs_value_float(float x)             { gs_value_t r = {0}; r.kind = GS_KIND_FLOAT; r.v.f = x; return r; }
+static GS_ALWAYS_INLINE gs_value_t gs_value_double(double x)           { gs_value_t r = {0}; r.kind = GS_KIND_DOUBLE; r.v.f = x; return r; }
+static GS_ALWAYS_INLINE gs_value_t gs_value_long_double(long double x) { gs_value_t r = {0}; r.kind = GS_KIND_LONG_DOUBLE; r.v.f = x; return r; }
+static GS_ALWAYS_INLINE gs_value_t gs_value_pointer(const volatile void *x) { gs_value_t r = {0}; r.kind = GS_KIND_OTHER; r.v.p = (const void *)x; return r; }
+
+/// ? Captures x, evaluating it once. The type is taken from `0 ? (x) : (x)`, which promotes bit-fields
+/// ? and small integers and decays arrays without evaluating anything.
+#define GS_VALUE(x)                                                                                        \
+    _Generic(0 ? (x) : (x),                                                                                \
+        int: gs_value_signed, long: gs_value_signed, long long: gs_value_signed,                           \
+        unsigned int: gs_value_unsigned, unsigned long: gs_value_unsigned,                                 \
+        unsigned long long: gs_value_unsigned,                                                             \
+        float: gs_value_float, double: gs_value_double, long double: gs_value_long_double,                 \
+        default: gs_value_pointer)(x)
+
+/// ? Three-way comparison of captured operands: -1, 0 or 1, or 2 when unordered (NaN).
+static GS_ALWAYS_INLINE int gs_value_cmp(gs_value_t a, gs_value_t b) {
+    if (GS_KIND_IS_FLOATING(a.kind) || GS_KIND_IS_FLOATING(b.kind)) {
+        long double x = GS_KIND_IS_FLOATING(a.kind) ? a.v.f : a.kind == GS_KIND_SIGNED ? (long double)a.v.s : (long double)a.v.u;
+        long double y = GS_KIND_IS_FLOATING(b.kind) ? b.v.f : b.kind == GS_KIND_SIGNED ? (long double)b.v.s : (long double)b.v.u;
+        return x < y ? -1 : x > y ? 1 : x == y ? 0 : 2;
+    }
+    if (a.kind == GS_KIND_SIGNED && b.kind == GS_KIND_SIGNED) {
+        return a.v.s < b.v.s ? -1 : a.v.s > b.v.s;
+    }
+    if (a.kind == GS_KIND_SIGNED && a.v.s < 0) return -1;
+    if (b.kind == GS_KIND_SIGNED && b.v.s < 0) return 1;
+    unsigned long long x = a.kind == GS_KIND_OTHER  ? (unsigned long long)(uintptr_t)a.v.p
+                         : a.kind == GS_KIND_SIGNED ? (unsigned long long)a.v.s : a.v.u;
+    unsigned long long y = b.kind == GS_KIND_OTHER  ? (unsigned long long)(uintptr_t)b.v.p
+                         : b.kind == GS_KIND_SIGNED ? (unsigned long long)b.v.s : b.v.u;
+    return x < y ? -1 : x > y;
+}
+
+/// ? Which assertion failed; selects how gs_failure_print formats the record
+typedef enum
+{
+    GS_FAIL_CONDITION,
+    GS_FAIL_EQ,
+    GS_FAIL_STR_EQ,
+    GS_FAIL_NOT_NULL,
+    GS_FAIL_NULL,
+    GS_FAIL_FLOAT_EQ,
+    GS_FAIL_IN_RANGE,
+    GS_FAIL_FILE_EXISTS,
+    GS_FAIL_OVERFLOW,
+} gs_fail_kind_t;
+
+/// ? Everything needed to describe a failed assertion, filled in only on failure
+typedef struct
+{
+    gs_fail_kind_t what;
+    const char    *message;
+    const char    *expression;   /// ? source text of the checked expression
+    const char    *file;
+    int            line;
+    gs_value_t     actual;
+    gs_value_t     expected;
+    gs_value_t     extra;        /// ? range maximum, epsilon, buffer size, ...
+} gs_failure_t;
+
+static gs_failure_t gs_last_failure;
+
+static inline void gs_value_format(gs_value_t value, char *buf, size_t len) {
+    switch (value.kind) {
+    case GS_KIND_SIGNED:      snprintf(buf, len, "%lld", value.v.s); break;
+    case GS_KIND_UNSIGNED:    snprintf(buf, len, "%llu", value.v.u); break;
+    case GS_KIND_FLOAT:       snprintf(buf, len, "%.9g", (double)value.v.f); break;
+    case GS_KIND_DOUBLE:      snprintf(buf, len, "%.17g", (double)value.v.f); break;
+    case GS_KIND_LONG_DOUBLE: snprintf(buf, len, "%.21Lg", value.v.f); break;
+    default:                  snprintf(buf, len, "%p", value.v.p); break;
+    }
+}
+
+static inline void gs_failure_print(const gs_failure_t *f) {
+    char a[64], e[64], x[64];
+    gs_value_format(f->actual, a, sizeof(a));
+    gs_value_format(f->expected, e, sizeof(e));
+    gs_value_format(f->extra, x, sizeof(x));
+    switch (f->what) {
+    case GS_FAIL_CONDITION:
+        fprintf(stderr, "FAIL: %s\n", f->message);
+        break;
+    case GS_FAIL_EQ:
+        fprintf(stderr, "FAIL: %s - Expected: %s, Got: %s\n", f->message, e, a);
+        break;
+    case GS_FAIL_STR_EQ:
+        fprintf(stderr, "FAIL: %s - Expected: \"%s\", Got: \"%s\"\n", f->message,
+                f->expected.v.p ? (const char *)f->expected.v.p : "(null)",
+                f->actual.v.p ? (const char *)f->actual.v.p : "(null)");
+        break;
+    case GS_FAIL_NOT_NULL:
+        fprintf(stderr, "FAIL: %s - Pointer is NULL\n", f->message);
+        break;
+    case GS_FAIL_NULL:
+        fprintf(stderr, "FAIL: %s - Expected NULL pointer\n", f->message);
+        break;
+    case GS_FAIL_FLOAT_EQ:
+        fprintf(stderr, "FAIL: %s - Expected: %f, Got: %f (diff: %f)\n", f->message,
+                (double)f->expected.v.f, (double)f->actual.v.f, fabs((double)(f->actual.v.f - f->expected.v.f)));
+        break;
+    case GS_FAIL_IN_RANGE:
+        fprintf(stderr, "FAIL: %s - Value %s not in range [%s, %s]\n", f->message, a, e, x);
+        break;
+    case GS_FAIL_FILE_EXISTS:
+        fprintf(stderr, "FAIL: %s - File '%s' does not exist\n", f->message, (const char *)f->actual.v.p);
+        break;
+    case GS_FAIL_OVERFLOW:
+        fprintf(stderr, "FAIL: %s - Buffer overflow detected (writing %s bytes to %s byte buffer)\n",
+                f->message, a, x);
+        break;
+    }
+    fprintf(stderr, "  %s (%s:%d)\n", f->expression, f->file, f->line);
+}
+
+/// ? The failure branch of every scalar assertion: record the operands, then format them.
+static GS_COLD void gs_assert_failed(gs_fail_kind_t what, const char *message, const char *expression,
+                                     const char *file, int line,
+                                     gs_value_t actual, gs_value_t expected, gs_value_t extra) {
+    gs_last_failure.what       = what;
+    gs_last_failure.message    = message;
+    gs_last_failure.expression = expression;
+    gs_last_failure.file       = file;
+    gs_last_failure.line       = line;
+    gs_last_failure.actual     = actual;
+    gs_last_failure.expected   = expected;
+    gs_last_failure.extra      = extra;
+    gs_failure_print(&gs_last_failure);
+}
+
+#define GS_ASSERT_FAILED(what, message, expression, actual, expected, extra)                               \
+    gs_assert_failed(what, message, expression, __FILE__, __LINE__, actual, expected, extra)
+
 #define TEST_ASSERT(condition, message)                                                                \
     do {                                                                                               \
-        if (!(condition)) {                                                                            \
-            fprintf(stderr, "FAIL: %s\n", message);                                                    \
+        if (GS_UNLIKELY(!(condition))) {                                                               \
+            gs_value_t _none = gs_value_pointer(NULL);                                                 \
+            GS_ASSERT_FAILED(GS_FAIL_CONDITION, message, #condition, _none, _none, _none);             \
             return 0;                                                                                  \
-        } else {                                                                                       \
-            printf("PASS: %s\n", message);                                                             \
         }                                                                                              \
+        GS_PASS("%s\n", message);                                                                      \
     } while(0)
 
 
 
+// Trace spans
+//
+// Spans are complete enter/exit intervals on CLOCK_MONOTONIC. Each thread appends them to its own
+// preallocated buffer (GS_TRACE_EVENTS per thread; later spans are counted as dropped), so recording
+// takes no lock. RUN_TEST, RUN_SUITE_TEST, BENCHMARK_START/END and concurrent stress workers record
+// spans, as do TRACE_FUNCTION() and TRACE_SCOPE(name) below. Recording is on when GS_TRACE_FILE is
+// set, in which case the trace is written there at exit, or after TRACE_START(). TRACE_EXPORT(path)
+// writes Chrome trace-event JSON that chrome://tracing and Perfetto open as a per-thread timeline.
+//
+// Span names are stored as pointers and must outlive the export: use string literals or __func__.
+
+#define GS_TRACE_EVENTS 65536
+
+#define GS_NO_INSTRUMENT __attribute__((no_instrument_function))
+
+typedef struct
+{
+    const char *name;      /// ? NULL for -finstrument-functions spans, named from addr on export
+    const char *category;
+    const void *addr;
+    uint64_t    start_ns;
+    uint64_t    duration_ns;
+} gs_trace_event_t;
+
+typedef struct gs_trace_buffer
+{
+    struct gs_trace_buffer *next;      /// ? all buffers ever created, newest first
+    long                    tid;
+    char                    thread_name[32];
+    int                     count;
+    long                    dropped;
+    gs_trace_event_t        events[GS_TRACE_EVENTS];
+} gs_trace_buffer_t;
+
+static int                       gs_trace_state   = 0;      /// ? 0 undecided, 1 recording, -1 off
+static pid_t                     gs_trace_owner   = 0;      /// ? process that registered the exit export
+static gs_trace_buffer_t        *gs_trace_buffers = NULL;
+static __thread gs_trace_buffer_t *gs_trace_local = NULL;
+
+static void gs_trace_export_at_exit(void);
+
+static inline GS_NO_INSTRUMENT uint64_t gs_trace_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+static inline GS_NO_INSTRUMENT int gs_trace_enabled(void) {
+    if (__builtin_expect(gs_trace_state == 0, 0)) {
+        const char *path = getenv("GS_TRACE_FILE");
+        gs_trace_state = path && *path ? 1 : -1;
+        if (gs_trace_state == 1) {
+            gs_trace_owner = getpid();
+            atexit(gs_trace_export_at_exit);
+        }
+    }
+    return gs_trace_state == 1;
+}
+
+static inline GS_NO_INSTRUMENT void gs_trace_start(void) {
+    gs_trace_enabled();
+    gs_trace_state = 1;
+}
+
+/// ? The calling thread's buffer, created and registered on first use; NULL if it cannot be mapped.
+static inline GS_NO_INSTRUMENT gs_trace_buffer_t *gs_trace_thread_buffer(void) {
+    if (__builtin_expect(gs_trace_local == NULL, 0)) {
+        void *map = mmap(NULL, sizeof(gs_trace_buffer_t), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map == MAP_FAILED) {
+            return NULL;
+        }
+        gs_trace_buffer_t *buffer = map;
+        buffer->tid = (long)syscall(SYS_gettid);
+        snprintf(buffer->thread_name, sizeof(buffer->thread_name), "%s",
+                 buffer->tid == (long)getpid() ? "main" : "thread");
+        buffer->next = __atomic_load_n(&gs_trace_buffers, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&gs_trace_buffers, &buffer->next, buffer, 1,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+        gs_trace_local = buffer;
+    }
+    return gs_trace_local;
+}
+
+/// ? Names the calling thread's track in the exported timeline.
+static inline GS_NO_INSTRUMENT void gs_trace_thread_name(const char *name) {
+    gs_trace_buffer_t *buffer = gs_trace_enabled() ? gs_trace_thread_buffer() : NULL;
+    if (buffer) {
+        snprintf(buffer->thread_name, sizeof(buffer->thread_name), "%s", name);
+    }
+}
+
+static inline GS_NO_INSTRUMENT void gs_trace_record(const char *name, const char *category, const void *addr,
+                                                    uint64_t start_ns, uint64_t end_ns) {
+    gs_trace_buffer_t *buffer = gs_trace_thread_buffer();
+    if (buffer == NULL) {
+        return;
+    }
+    if (buffer->count == GS_TRACE_EVENTS) {
+        buffer->dropped++;
+        return;
+    }
+    gs_trace_event_t *event = &buffer->events[buffer->count];
+    event->name        = name;
+    event->category    = category;
+    event->addr        = addr;
+    event->start_ns    = start_ns;
+    event->duration_ns = end_ns - start_ns;
+    /// ? Publish the event only once it is complete, for exports racing with this thread
+    __atomic_store_n(&buffer->count, buffer->count + 1, __ATOMIC_RELEASE);
+}
+
+// Per-test resource accounting
+//
+// RUN_TEST brackets every test with gs_test_begin()/gs_test_end(), which record its wall time
+// (CLOCK_MONOTONIC), user and system CPU, voluntary and involuntary context switches and minor and
+// major page faults (getrusage(RUSAGE_THREAD)), and the bytes read and written through syscalls
+// (rchar/wchar from /proc/thread-self/io). RUN_SUITE_TEST records the same figures for its child
+// process. PRINT_TEST_SUMMARY lists the ten slowest tests, and with GS_REPORT=path it also writes
+// every record to path as JSON.
+
+#define GS_TEST_RECORDS_MAX 4096
+
+typedef struct
+{
+    const char *name;
+    int         passed;
+    double      wall_ms;
+    double      user_ms;
+    double      sys_ms;
+    long        voluntary_switches;
+    long        involuntary_switches;
+    long        minor_faults;
+    long        major_faults;
+    long long   read_bytes;
+    long long   write_bytes;
+} gs_test_record_t;
+
+/// ? Snapshot taken by gs_test_begin
+typedef struct
+{
+    const char     *name;
+    struct timespec wall;
+    struct rusage   usage;
+    long long       read_bytes;
+    long long       write_bytes;
+} gs_test_start_t;
+
+static gs_test_record_t gs_test_records[GS_TEST_RECORDS_MAX];
+static int              gs_test_record_count = 0;
+static gs_test_start_t  gs_test_current;
+
+/// ? Reads rchar/wchar from a /proc io file; both stay 0 if it cannot be read. Returns the number of
+/// ? bytes read, which the kernel adds to rchar only after producing the file's contents.
+static inline long long gs_read_proc_io(const char *path, long long *read_bytes, long long *write_bytes) {
+    *read_bytes = *write_bytes = 0;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    char buf[512];
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) {
+        return 0;
+    }
+    buf[n] = '\0';
+    const char *r = strstr(buf, "rchar:");
+    const char *w = strstr(buf, "wchar:");
+    if (r) *read_bytes  = atoll(r + 6);
+    if (w) *write_bytes = atoll(w + 6);
+    return n;
+}
+
+static inline double gs_timeval_ms(struct timeval t) {
+    return t.tv_sec * 1e3 + t.tv_usec / 1e3;
+}
+
+static inline void gs_test_begin(const char *name) {
+    printf("Running %s...\n", name);
+    gs_test_current.name = name;
+    /// ? Count this read in the baseline, so a test that does no I/O reports 0 bytes read
+    long long baseline_read = gs_read_proc_io("/proc/thread-self/io", &gs_test_current.read_bytes,
+                                              &gs_test_current.write_bytes);
+    gs_test_current.read_bytes += baseline_read;
+    getrusage(GS_RUSAGE_TEST, &gs_test_current.usage);
+    clock_gettime(CLOCK_MONOTONIC, &gs_test_current.wall);
+}
+
+/// ? Stores a record for the current test from `usage` and the io counters, and counts its result.
+static inline void gs_test_record(int passed, const struct rusage *usage, long long read_bytes, long long write_bytes) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (gs_trace_enabled()) {
+        gs_trace_record(gs_test_current.name, "test", NULL,
+                        (uint64_t)gs_test_current.wall.tv_sec * 1000000000ULL + (uint64_t)gs_test_current.wall.tv_nsec,
+                        (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec);
+    }
+    if (gs_test_record_count < GS_TEST_RECORDS_MAX) {
+        gs_test_record_t *r = &gs_test_records[gs_test_record_count++];
+        r->name                 = gs_test_current.name;
+        r->passed               = passed;
+        r->wall_ms              = (now.tv_sec - gs_test_current.wall.tv_sec) * 1e3 +
+                                  (now.tv_nsec - gs_test_current.wall.tv_nsec) / 1e6;
+        r->user_ms              = gs_timeval_ms(usage->ru_utime);
+        r->sys_ms               = gs_timeval_ms(usage->ru_stime);
+        r->voluntary_switches   = usage->ru_nvcsw;
+        r->involuntary_switches = usage->ru_nivcsw;
+        r->minor_faults         = usage->ru_minflt;
+        r->major_faults         = usage->ru_majflt;
+        r->read_bytes           = read_bytes;
+        r->write_bytes          = write_bytes;
+    }
+    if (passed) {
+        tests_passed++;
+    } else {
+        tests_failed++;
+    }
+    total_tests++;
+}
+
+static inline void gs_test_end(int passed) {
+    struct rusage end, delta;
+    long long read_bytes, write_bytes;
+    getrusage(GS_RUSAGE_TEST, &end);
+    gs_read_proc_io("/proc/thread-self/io", &read_bytes, &write_bytes);
+    const struct rusage *start = &gs_test_current.usage;
+    memset(&delta, 0, sizeof(delta));
+    /// ? tv_usec may go negative here; gs_timeval_ms only needs sec * 1e6 + usec to be right
+    delta.ru_utime.tv_sec  = end.ru_utime.tv_sec  - start->ru_utime.tv_sec;
+    delta.ru_utime.tv_usec = end.ru_utime.tv_usec - start->ru_utime.tv_usec;
+    delta.ru_stime.tv_sec  = end.ru_stime.tv_sec  - start->ru_stime.tv_sec;
+    delta.ru_stime.tv_usec = end.ru_stime.tv_usec - start->ru_stime.tv_usec;
+    delta.ru_nvcsw  = end.ru_nvcsw  - start->ru_nvcsw;
+    delta.ru_nivcsw = end.ru_nivcsw - start->ru_nivcsw;
+    delta.ru_minflt = end.ru_minflt - start->ru_minflt;
+    delta.ru_majflt = end.ru_majflt - start->ru_majflt;
+    gs_test_record(passed, &delta, read_bytes - gs_test_current.read_bytes, write_bytes - gs_test_current.write_bytes);
+}
+
+/// ? Prints the `limit` slowest recorded tests by wall time.
+static inline void gs_print_slowest_tests(int limit) {
+    if (gs_test_record_count == 0) {
+        return;
+    }
+    char shown[GS_TEST_RECORDS_MAX] = {0};
+    printf("\n--- Slowest tests ---\n");
+    printf("  %10s %10s %10s %7s %7s %8s %7s %10s %10s  %s\n", "wall ms", "user ms", "sys ms",
+           "vcsw", "ivcsw", "minflt", "majflt", "read KB", "write KB", "test");
+    for (int n = 0; n < limit && n < gs_test_record_count; n++) {
+        int slowest = -1;
+        for (int i = 0; i < gs_test_record_count; i++) {
+            if (!shown[i] && (slowest < 0 || gs_test_records[i].wall_ms > gs_test_records[slowest].wall_ms)) {
+                slowest = i;
+            }
+        }
+        shown[slowest] = 1;
+        const gs_test_record_t *r = &gs_test_records[slowest];
+        printf("  %10.2f %10.2f %10.2f %7ld %7ld %8ld %7ld %10.1f %10.1f  %s%s\n", r->wall_ms, r->user_ms,
+               r->sys_ms, r->voluntary_switches, r->involuntary_switches, r->minor_faults, r->major_faults,
+               r->read_bytes / 1024.0, r->write_bytes / 1024.0, r->name, r->passed ? "" : " (failed)");
+    }
+}
+
+/// ? Writes the summary and every test record to $GS_REPORT as JSON, if set.
+static inline void gs_write_test_report(void) {
+    const char *path = getenv("GS_REPORT");
+    if (path == NULL || *path == '\0') {
+        return;
+    }
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+        fprintf(stderr, "WARNING: cannot write test report '%s': %s\n", path, strerror(errno));
+        return;
+    }
+    fprintf(out, "{\n  \"total\": %d,\n  \"passed\": %d,\n  \"failed\": %d,\n  \"assertions_passed\": %ld,\n"
+                 "  \"tests\": [", total_tests, tests_passed, tests_failed, gs_assertions_passed);
+    for (int i = 0; i < gs_test_record_count; i++) {
+        const gs_test_record_t *r = &gs_test_records[i];
+        fprintf(out, "%s\n    {\"name\": \"", i ? "," : "");
+        for (const char *c = r->name; *c; c++) {
+            if (*c == '"' || *c == '\\') fputc('\\', out);
+            fputc(*c, out);
+        }
+        fprintf(out, "\", \"passed\": %s, \"wall_ms\": %.3f, \"user_ms\": %.3f, \"sys_ms\": %.3f, "
+                     "\"voluntary_switches\": %ld, \"involuntary_switches\": %ld, \"minor_faults\": %ld, "
+                     "\"major_faults\": %ld, \"read_bytes\": %lld, \"write_bytes\": %lld}",
+                r->passed ? "true" : "false", r->wall_ms, r->user_ms, r->sys_ms, r->voluntary_switches,
+                r->involuntary_switches, r->minor_faults, r->major_faults, r->read_bytes, r->write_bytes);
+    }
+    fprintf(out, "\n  ]\n}\n");
+    if (fclose(out) != 0) {
+        fprintf(stderr, "WARNING: cannot write test report '%s': %s\n", path, strerror(errno));
+    }
+}
+
 #define RUN_TEST(test_func)                                                                            \
     do {                                                                                               \
-        printf("Running %s...\n", #test_func);                                                         \
-        if (test_func()) {                                                                             \
+        gs_test_begin(#test_func);                                                                     \
+        gs_seed_printed = 0;                                                                           \
+        gs_rng_used = 0;                                                                               \
+        int _passed = test_func();                                                                     \
+        gs_test_end(_passed);                                                                          \
+        if (_passed) {                                                                                 \
             printf("✓ %s passed\n\n", #test_func);                                                     \
-            tests_passed++;                                                                            \
         } else {                                                                                       \
-            printf("✗ %s failed\n\n", #test_func);                                                     \
-            tests_failed++;                                                                            \
+            printf("✗ %s failed\n", #test_func);                                                       \
+            GS_PRINT_SEED();                                                                           \
+            printf("\n");                                                                              \
         }                                                                                              \
-        total_tests++;                                                                                 \
     } while(0)
 
 
 
-#define TEST_EXPECT_CRASH(test_code, message)                                                          \
-    do {                                                                                               \
-        pid_t pid = fork();                                                                            \
-        if (pid == 0) {                                                                                \
-            test_code;                                                                                 \
-            exit(0);                                                                                   \
-        } else if (pid > 0) {                                                                          \
-            int status;                                                                                \
-            waitpid(pid, &status, 0);                                                                  \
-            if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {                                       \
-                fprintf(stderr, "FAIL: %s (expected crash but didn't crash)\n", message);              \
-                return 0;                                                                              \
-            } else {                                                                                   \
-                printf("PASS: %s (crashed as expected)\n", message);                                   \
-            }                                                                                          \
-        } else {                                                                                       \
-            fprintf(stderr, "FAIL: fork() failed for crash test\n");                                   \
-            return 0;                                                                                  \
-        }                                                                                              \
+// Crash testing
+//
+// The code under test runs in a forked child. stdio buffers are flushed before the fork and the child
+// leaves with _exit(), so nothing is printed twice; core dumps are disabled in the child, since
+// writing one for a large heap costs far more than the fork. The child's stderr is captured (up to
+// GS_CRASH_OUTPUT_MAX bytes) so CHECK messages can be matched, and it is echoed when a test fails.
+
+#define GS_CRASH_OUTPUT_MAX 4096
+
+static char gs_crash_output[GS_CRASH_OUTPUT_MAX];
+static int  gs_crash_pipe[2] = {-1, -1};
+
+/// ? Forks the crash-test child with its stderr redirected into gs_crash_output.
+static inline pid_t gs_crash_fork(void) {
+    fflush(stdout);
+    fflush(stderr);
+    if (pipe(gs_crash_pipe) != 0) {
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        struct rlimit no_core = {0, 0};
+        setrlimit(RLIMIT_CORE, &no_core);
+        close(gs_crash_pipe[0]);
+        dup2(gs_crash_pipe[1], STDERR_FILENO);
+        close(gs_crash_pipe[1]);
+    } else {
+        close(gs_crash_pipe[1]);
+        if (pid < 0) {
+            close(gs_crash_pipe[0]);
+        }
+    }
+    return pid;
+}
+
+static inline void gs_crash_child_exit(void) {
+    fflush(stdout);
+    fflush(stderr);
+    _exit(0);
+}
+
+/// ? Drains the child's stderr and returns its waitpid() status.
+static inline int gs_crash_wait(pid_t pid) {
+    size_t used = 0;
+    char discard[512];
+    for (;;) {
+        ssize_t got;
+        if (used < sizeof(gs_crash_output) - 1) {
+            got = read(gs_crash_pipe[0], gs_crash_output + used, sizeof(gs_crash_output) - 1 - used);
+            if (got > 0) used += (size_t)got;
+        } else {
+            got = read(gs_crash_pipe[0], discard, sizeof(discard));
+        }
+        if (got == 0 || (got < 0 && errno != EINTR)) {
+            break;
+        }
+    }
+    gs_crash_output[used] = '\0';
+    close(gs_crash_pipe[0]);
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    return status;
+}
+
+/// ? Describes a waitpid() status, e.g. "exited with status 1" or "killed by signal 11 (Segmentation fault)".
+static inline const char *gs_crash_describe(int status) {
+    static char description[96];
+    if (WIFSIGNALED(status)) {
+        snprintf(description, sizeof(description), "killed by signal %d (%s)", WTERMSIG(status), strsignal(WTERMSIG(status)));
+    } else {
+        snprintf(description, sizeof(description), "exited with status %d", WEXITSTATUS(status));
+    }
+    return description;
+}
+
+static inline void gs_crash_print_output(void) {
+    if (gs_crash_output[0] != '\0') {
+        fprintf(stderr, "  child stderr:\n");
+        for (const char *line = gs_crash_output; *line; ) {
+            const char *end = strchr(line, '\n');
+            int len = end ? (int)(end - line) : (int)strlen(line);
+            fprintf(stderr, "    | %.*s\n", len, line);
+            line += len + (end ? 1 : 0);
+        }
+    }
+}
+
+/// ? Sends stdout and stderr to /dev/null, for children whose output is only noise.
+static inline void gs_silence_output(void) {
+    int devnull = open("/dev/null", O_WRONLY);
+    if (devnull >= 0) {
+        dup2(devnull, STDOUT_FILENO);
+        dup2(devnull, STDERR_FILENO);
+        close(devnull);
+    }
+}
+
+/// ? Runs test_code in a child; fails the test unless `matches` holds for the child's _status.
+#define GS_EXPECT_CHILD(test_code, matches, expectation, message)                                          \
+    do {                                                                                                   \
+        pid_t _pid = gs_crash_fork();                                                                      \
+        if (_pid == 0) {                                                                                   \
+            test_code;                                                                                     \
+            gs_crash_child_exit();                                                                         \
+        } else if (_pid < 0) {                                                                             \
+            fprintf(stderr, "FAIL: fork() failed for crash test\n");                                       \
+            return 0;                                                                                      \
+        }                                                                                                  \
+        int _status = gs_crash_wait(_pid);                                                                 \
+        if (!(matches)) {                                                                                  \
+            fprintf(stderr, "FAIL: %s (expected %s, but child %s)\n",                                      \
+                    message, expectation, gs_crash_describe(_status));                                     \
+            gs_crash_print_output();                                                                       \
+            return 0;                                                                                      \
+        } else {                                                                                           \
+            GS_PASS("%s (%s as expected)\n", message, gs_crash_describe(_status));                         \
+        }                                                                                                  \
     } while(0)
 
+/// ? Passes when the child dies in any way other than exiting with status 0
+#define TEST_EXPECT_CRASH(test_code, message)                                                              \
+    GS_EXPECT_CHILD(test_code, !(WIFEXITED(_status) && WEXITSTATUS(_status) == 0),                         \
+                    "a crash", message)
+
+#define TEST_EXPECT_SIGNAL(test_code, signo, message)                                                      \
+    GS_EXPECT_CHILD(test_code, WIFSIGNALED(_status) && WTERMSIG(_status) == (signo),                       \
+                    "signal " #signo, message)
+
+#define TEST_EXPECT_EXIT(test_code, exit_status, message)                                                  \
+    GS_EXPECT_CHILD(test_code, WIFEXITED(_status) && WEXITSTATUS(_status) == (exit_status),                \
+                    "exit status " #exit_status, message)
+
+/// ? Passes when the child dies in any way and its stderr contains expected_stderr
+#define TEST_EXPECT_CRASH_OUTPUT(test_code, expected_stderr, message)                                      \
+    GS_EXPECT_CHILD(test_code,                                                                             \
+                    !(WIFEXITED(_status) && WEXITSTATUS(_status) == 0) &&                                  \
+                    strstr(gs_crash_output, (expected_stderr)) != NULL,                                    \
+                    "a crash printing " #expected_stderr, message)
+
 
 #define CHECK_PTR(ptr)                                                                                 \
     do {                                                                                               \
@@ -275,52 +969,66 @@ typedef enum
 
 #define TEST_ASSERT_EQ(actual, expected, message)                                                           \
     do {                                                                                                    \
-        if ((actual) != (expected)) {                                                                       \
-            fprintf(stderr, "FAIL: %s - Expected: %d, Got: %d\n", message, (int)(expected), (int)(actual)); \
+        gs_value_t _a = GS_VALUE(actual);                                                                   \
+        gs_value_t _e = GS_VALUE(expected);                                                                 \
+        if (GS_UNLIKELY(gs_value_cmp(_a, _e) != 0)) {                                                       \
+            GS_ASSERT_FAILED(GS_FAIL_EQ, message, #actual " == " #expected, _a, _e, _e);                    \
             return 0;                                                                                       \
-        } else {                                                                                            \
-            printf("PASS: %s\n", message);                                                                  \
         }                                                                                                   \
+        GS_PASS("%s\n", message);                                                                           \
     } while(0)
 
 #define TEST_ASSERT_STR_EQ(actual, expected, message)                                                       \
     do {                                                                                                    \
-        if (strcmp((actual), (expected)) != 0) {                                                            \
-            fprintf(stderr, "FAIL: %s - Expected: \"%s\", Got: \"%s\"\n", message, expected, actual);       \
+        const char *_actual   = (actual);                                                                   \
+        const char *_expected = (expected);                                                                 \
+        if (GS_UNLIKELY(_actual != _expected &&                                                             \
+                        (!_actual || !_expected || strcmp(_actual, _expected) != 0))) {                     \
+            gs_value_t _a = gs_value_pointer(_actual);                                                      \
+            gs_value_t _e = gs_value_pointer(_expected);                                                    \
+            GS_ASSERT_FAILED(GS_FAIL_STR_EQ, message, #actual " equals " #expected, _a, _e, _e);            \
             return 0;                                                                                       \
-        } else {                                                                                            \
-            printf("PASS: %s\n", message);                                                                  \
         }                                                                                                   \
+        GS_PASS("%s\n", message);                                                                           \
     } while(0)
 
 #define TEST_ASSERT_NOT_NULL(ptr, message)                                                                  \
     do {                                                                                                    \
-        if ((ptr) == NULL) {                                                                                \
-            fprintf(stderr, "FAIL: %s - Pointer is NULL\n", message);                                       \
+        if (GS_UNLIKELY((ptr) == NULL)) {                                                                   \
+            gs_value_t _none = gs_value_pointer(NULL);                                                      \
+            GS_ASSERT_FAILED(GS_FAIL_NOT_NULL, message, #ptr " != NULL", _none, _none, _none);              \
             return 0;                                                                                       \
-        } else {                                                                                            \
-            printf("PASS: %s\n", message);                                                                  \
         }                                                                                                   \
+        GS_PASS("%s\n", message);                                                                           \
     } while(0)
 
 #define TEST_ASSERT_NULL(ptr, message)                                                                      \
     do {                                                                                                    \
-        if ((ptr) != NULL) {                                                                                \
-            fprintf(stderr, "FAIL: %s - Expected NULL pointer\n", message);                                 \
+        const volatile void *_ptr = (ptr);                                                                  \
+        if (GS_UNLIKELY(_ptr != NULL)) {                                                                    \
+            gs_value_t _p = gs_value_pointer(_ptr);                                                         \
+            GS_ASSERT_FAILED(GS_FAIL_NULL, message, #ptr " == NULL", _p, gs_value_pointer(NULL), _p);       \
             return 0;                                                                                       \
-        } else {                                                                                            \
-            printf("PASS: %s\n", message);                                                                  \
         }                                                                                                   \
+        GS_PASS("%s\n", message);                                                                           \
     } while(0)
 
 #define BENCHMARK_START()                                                                                   \
-    clock_t _start_time = clock()
+    clock_t _start_time = clock();                                                                          \
+    uint64_t _trace_start = gs_trace_now();                                                                 \
+    int _profiling = gs_profile_wanted() && gs_profile_start()
 
-#define BENCHMARK_END(operation_name)                                                                       \
-    do {                                                                                                    \
-        clock_t _end_time = clock();                                                                        \
-        double _cpu_time = ((double)(_end_time - _start_time)) / CLOCKS_PER_SEC;                            \
-        printf("BENCHMARK: %s took %f seconds\n", operation_name, _cpu_time);                               \
+#define BENCHMARK_END(operation_name)                                                                   \
+    do {                                                                                                \
+        clock_t _end_time = clock();                                                                    \
+        double _cpu_time = ((double)(_end_time - _start_time)) / CLOCKS_PER_SEC;                        \
+        if (gs_trace_enabled()) {                                                                       \
+            gs_trace_record(operation_name, "benchmark", NULL, _trace_start, gs_trace_now());           \
+        }                                                                                               \
+        printf("BENCHMARK: %s took %f seconds\n", operation_name, _cpu_time);                           \
+        if (_profiling) {                                                                               \
+            gs_profile_stop(operation_name);                                                            \
+        }                                                                                               \
     } while(0)
 
 #define PRINT_TEST_SUMMARY()                                                                                \
@@ -329,8 +1037,11 @@ typedef enum
         printf("Total tests: %d\n", total_tests);                                                           \
         printf("Passed: %d\n", tests_passed);                                                               \
         printf("Failed: %d\n", tests_failed);                                                               \
+        printf("Assertions passed: %ld\n", gs_assertions_passed);                                           \
         printf("Success rate: %.1f%%\n", total_tests > 0 ? (tests_passed * 100.0) / total_tests : 0.0);     \
+        gs_print_slowest_tests(10);                                                                         \
         printf("==================\n");                                                                     \
+        gs_write_test_report();                                                                             \
     } while(0)
 
 
@@ -395,47 +1106,261 @@ typedef enum
     } while(0)
 
 // Array testing
+//
+// Integer and pointer arrays of matching element size are compared with memcmp in 4 KiB chunks;
+// the chunk that differs is scanned to find the first mismatching element. Floating point arrays
+// and arrays with different element types fall back to an element loop, since memcmp would disagree
+// with == for -0.0 and NaN. Lengths are size_t. On failure a window of values around the first
+// mismatch is printed along with the number of differing elements.
+//
+// TEST_ASSERT_FLOAT_ARRAY_EQ compares float or double arrays within an absolute epsilon, and
+// TEST_ASSERT_FLOAT_ARRAY_ULP within a number of units in the last place. Both check 64-element
+// blocks without branches so the compiler can vectorize them, and both treat NaN as equal to NaN.
+
+/// ? Index of the first differing element of two arrays with identical representation, or count.
+static inline size_t gs_mem_first_diff(const void *actual, const void *expected, size_t count, size_t elem_size) {
+    const unsigned char *a = actual;
+    const unsigned char *e = expected;
+    size_t bytes = count * elem_size;
+    for (size_t offset = 0; offset < bytes; offset += 4096) {
+        size_t chunk = bytes - offset < 4096 ? bytes - offset : 4096;
+        if (memcmp(a + offset, e + offset, chunk) != 0) {
+            size_t i = offset;
+            while (a[i] == e[i]) i++;
+            return i / elem_size;
+        }
+    }
+    return count;
+}
+
+/// ? Formats element `index` of an array of the given kind and size.
+static inline void gs_format_element(const void *array, size_t index, size_t elem_size, gs_kind_t kind,
+                                     char *buf, size_t len) {
+    const unsigned char *p = (const unsigned char *)array + index * elem_size;
+    if (kind == GS_KIND_SIGNED || kind == GS_KIND_UNSIGNED) {
+        unsigned long long bits = 0;
+        if (elem_size == 1)      { uint8_t v;  memcpy(&v, p, 1); bits = v; }
+        else if (elem_size == 2) { uint16_t v; memcpy(&v, p, 2); bits = v; }
+        else if (elem_size == 4) { uint32_t v; memcpy(&v, p, 4); bits = v; }
+        else                     { uint64_t v; memcpy(&v, p, 8); bits = v; }
+        if (kind == GS_KIND_SIGNED) {
+            int shift = 64 - 8 * (int)elem_size;
+            long long value = shift ? (long long)(bits << shift) >> shift : (long long)bits;
+            snprintf(buf, len, "%lld (0x%0*llx)", value, (int)elem_size * 2, bits);
+        } else {
+            snprintf(buf, len, "%llu (0x%0*llx)", bits, (int)elem_size * 2, bits);
+        }
+    } else if (kind == GS_KIND_FLOAT) {
+        float v;
+        memcpy(&v, p, sizeof(v));
+        snprintf(buf, len, "%.9g", v);
+    } else if (kind == GS_KIND_DOUBLE) {
+        double v;
+        memcpy(&v, p, sizeof(v));
+        snprintf(buf, len, "%.17g", v);
+    } else if (kind == GS_KIND_LONG_DOUBLE) {
+        long double v;
+        memcpy(&v, p, sizeof(v));
+        snprintf(buf, len, "%.21Lg", v);
+    } else {
+        size_t used = 0;
+        buf[0] = '\0';
+        for (size_t i = 0; i < elem_size && used + 3 < len; i++) {
+            used += (size_t)snprintf(buf + used, len - used, "%02x", p[i]);
+        }
+    }
+}
+
+/// ? The diff window covers GS_DIFF_WINDOW elements either side of the first mismatch.
+#define GS_DIFF_WINDOW 4
+#define GS_DIFF_WINDOW_FROM(mismatch) ((mismatch) > GS_DIFF_WINDOW ? (mismatch) - GS_DIFF_WINDOW : 0)
+#define GS_DIFF_WINDOW_TO(mismatch, count) \
+    ((mismatch) + GS_DIFF_WINDOW + 1 < (count) ? (mismatch) + GS_DIFF_WINDOW + 1 : (count))
+
+/// ? Prints the elements around the first mismatch. Bit k of `differs` marks element from+k.
+static inline void gs_array_diff_report(const void *actual, size_t actual_size, gs_kind_t actual_kind,
+                                        const void *expected, size_t expected_size, gs_kind_t expected_kind,
+                                        size_t count, size_t mismatch, size_t differing, unsigned differs) {
+    fprintf(stderr, "  first mismatch at index %zu; %zu of %zu elements differ\n", mismatch, differing, count);
+    size_t from = GS_DIFF_WINDOW_FROM(mismatch);
+    size_t to   = GS_DIFF_WINDOW_TO(mismatch, count);
+    for (size_t i = from; i < to; i++) {
+        char a[64], e[64];
+        gs_format_element(actual, i, actual_size, actual_kind, a, sizeof(a));
+        gs_format_element(expected, i, expected_size, expected_kind, e, sizeof(e));
+        fprintf(stderr, "  %c[%zu] expected %s, got %s\n", (differs >> (i - from)) & 1 ? '>' : ' ', i, e, a);
+    }
+}
+
+#define GS_FLOAT_BLOCK 64
+
+#define GS_DEFINE_FLOAT_DIFF(suffix, type, itype, fabs_fn)                                                 \
+    static inline int gs_equal_abs_##suffix(type a, type e, type epsilon) {                                \
+        return (fabs_fn(a - e) <= epsilon) | (a == e) | ((a != a) & (e != e));                             \
+    }                                                                                                      \
+    static inline int gs_equal_ulp_##suffix(type a, type e, unsigned long long max_ulps) {                 \
+        itype ia, ie;                                                                                      \
+        memcpy(&ia, &a, sizeof(ia));                                                                       \
+        memcpy(&ie, &e, sizeof(ie));                                                                       \
+        /* map sign-magnitude bits onto a monotonic integer line */                                        \
+        ia = ia < 0 ? (itype)((u##itype)1 << (sizeof(itype) * 8 - 1)) - ia : ia;                           \
+        ie = ie < 0 ? (itype)((u##itype)1 << (sizeof(itype) * 8 - 1)) - ie : ie;                           \
+        u##itype distance = ia > ie ? (u##itype)ia - (u##itype)ie : (u##itype)ie - (u##itype)ia;           \
+        return (distance <= max_ulps) | ((a != a) & (e != e));                                             \
+    }                                                                                                      \
+    static inline size_t gs_first_diff_abs_##suffix(const type *a, const type *e, size_t n, double eps) {  \
+        size_t i = 0;                                                                                      \
+        for (; i + GS_FLOAT_BLOCK <= n; i += GS_FLOAT_BLOCK) {                                             \
+            int equal = 1;                                                                                 \
+            for (size_t j = 0; j < GS_FLOAT_BLOCK; j++) {                                                  \
+                equal &= gs_equal_abs_##suffix(a[i + j], e[i + j], (type)eps);                             \
+            }                                                                                              \
+            if (!equal) break;                                                                             \
+        }                                                                                                  \
+        for (; i < n; i++) {                                                                               \
+            if (!gs_equal_abs_##suffix(a[i], e[i], (type)eps)) return i;                                   \
+        }                                                                                                  \
+        return n;                                                                                          \
+    }                                                                                                      \
+    static inline size_t gs_first_diff_ulp_##suffix(const type *a, const type *e, size_t n,               \
+                                                    unsigned long long max_ulps) {                         \
+        size_t i = 0;                                                                                      \
+        for (; i + GS_FLOAT_BLOCK <= n; i += GS_FLOAT_BLOCK) {                                             \
+            int equal = 1;                                                                                 \
+            for (size_t j = 0; j < GS_FLOAT_BLOCK; j++) {                                                  \
+                equal &= gs_equal_ulp_##suffix(a[i + j], e[i + j], max_ulps);                              \
+            }                                                                                              \
+            if (!equal) break;                                                                             \
+        }                                                                                                  \
+        for (; i < n; i++) {                                                                               \
+            if (!gs_equal_ulp_##suffix(a[i], e[i], max_ulps)) return i;                                    \
+        }                                                                                                  \
+        return n;                                                                                          \
+    }                                                                                                      \
+    static inline size_t gs_count_diff_abs_##suffix(const type *a, const type *e, size_t n, double eps) {  \
+        size_t differing = 0;                                                                              \
+        for (size_t i = 0; i < n; i++) differing += !gs_equal_abs_##suffix(a[i], e[i], (type)eps);         \
+        return differing;                                                                                  \
+    }                                                                                                      \
+    static inline size_t gs_count_diff_ulp_##suffix(const type *a, const type *e, size_t n,               \
+                                                    unsigned long long max_ulps) {                         \
+        size_t differing = 0;                                                                              \
+        for (size_t i = 0; i < n; i++) differing += !gs_equal_ulp_##suffix(a[i], e[i], max_ulps);          \
+        return differing;                                                                                  \
+    }
+
+GS_DEFINE_FLOAT_DIFF(f, float, int32_t, fabsf)
+GS_DEFINE_FLOAT_DIFF(d, double, int64_t, fabs)
+
 #define TEST_ASSERT_ARRAY_EQ(actual, expected, size, message)                                              \
     do {                                                                                                   \
-        int _arrays_equal = 1;                                                                             \
-        for (int _i = 0; _i < (size); _i++) {                                                              \
-            if ((actual)[_i] != (expected)[_i]) {                                                          \
-                _arrays_equal = 0;                                                                         \
-                break;                                                                                     \
+        size_t _count    = (size_t)(size);                                                                 \
+        size_t _mismatch = _count;                                                                         \
+        size_t _differing = 0;                                                                             \
+        gs_kind_t _a_kind = GS_KIND_OF((actual)[0]);                                                       \
+        gs_kind_t _e_kind = GS_KIND_OF((expected)[0]);                                                     \
+        int _bytewise = sizeof((actual)[0]) == sizeof((expected)[0]) &&                                    \
+                        !GS_KIND_IS_FLOATING(_a_kind) && !GS_KIND_IS_FLOATING(_e_kind);                    \
+        if (_bytewise) {                                                                                   \
+            _mismatch = gs_mem_first_diff((actual), (expected), _count, sizeof((actual)[0]));              \
+        } else {                                                                                           \
+            for (size_t _i = 0; _i < _count; _i++) {                                                       \
+                if ((actual)[_i] != (expected)[_i]) {                                                      \
+                    _mismatch = _i;                                                                        \
+                    break;                                                                                 \
+                }                                                                                          \
             }                                                                                              \
         }                                                                                                  \
-        if (!_arrays_equal) {                                                                              \
+        if (GS_UNLIKELY(_mismatch < _count)) {                                                             \
+            size_t _from = GS_DIFF_WINDOW_FROM(_mismatch);                                                 \
+            size_t _to   = GS_DIFF_WINDOW_TO(_mismatch, _count);                                           \
+            unsigned _differs = 0;                                                                         \
+            for (size_t _i = _from; _i < _count; _i++) {                                                   \
+                int _d = _bytewise ? memcmp(&(actual)[_i], &(expected)[_i], sizeof((actual)[0])) != 0      \
+                                   : (actual)[_i] != (expected)[_i];                                       \
+                _differing += (size_t)_d;                                                                  \
+                if (_i < _to) _differs |= (unsigned)_d << (_i - _from);                                    \
+            }                                                                                              \
             fprintf(stderr, "FAIL: %s - Arrays differ\n", message);                                        \
+            gs_array_diff_report((actual), sizeof((actual)[0]), _a_kind, (expected), sizeof((expected)[0]), \
+                                 _e_kind, _count, _mismatch, _differing, _differs);                        \
+            return 0;                                                                                      \
+        } else {                                                                                           \
+            GS_PASS("%s\n", message);                                                                      \
+        }                                                                                                  \
+    } while(0)
+
+/// ? 1 for float, 2 for double, 0 for anything else; both arrays must agree at compile time
+#define GS_FLOAT_ELEMENT(x) _Generic((x), float: 1, double: 2, default: 0)
+
+/// ? Shared body of the float array assertions; `how` is abs or ulp and `tolerance` its bound
+#define GS_ASSERT_FLOAT_ARRAY(actual, expected, size, how, tolerance, message)                             \
+    do {                                                                                                   \
+        _Static_assert(GS_FLOAT_ELEMENT((actual)[0]) != 0 &&                                               \
+                       GS_FLOAT_ELEMENT((actual)[0]) == GS_FLOAT_ELEMENT((expected)[0]),                   \
+                       "float array assertions need two float arrays or two double arrays");               \
+        size_t _count = (size_t)(size);                                                                    \
+        size_t _mismatch = _Generic((actual)[0],                                                           \
+            float:   gs_first_diff_##how##_f,                                                              \
+            default: gs_first_diff_##how##_d)((actual), (expected), _count, (tolerance));                  \
+        if (GS_UNLIKELY(_mismatch < _count)) {                                                             \
+            size_t _from = GS_DIFF_WINDOW_FROM(_mismatch);                                                 \
+            size_t _to   = GS_DIFF_WINDOW_TO(_mismatch, _count);                                           \
+            size_t _differing = _Generic((actual)[0],                                                      \
+                float:   gs_count_diff_##how##_f,                                                          \
+                default: gs_count_diff_##how##_d)((actual) + _mismatch, (expected) + _mismatch,            \
+                                                  _count - _mismatch, (tolerance));                        \
+            unsigned _differs = 0;                                                                         \
+            for (size_t _i = _from; _i < _to; _i++) {                                                      \
+                _differs |= (unsigned)!_Generic((actual)[0],                                               \
+                    float:   gs_equal_##how##_f,                                                           \
+                    default: gs_equal_##how##_d)((actual)[_i], (expected)[_i], (tolerance)) << (_i - _from); \
+            }                                                                                              \
+            fprintf(stderr, "FAIL: %s - Arrays differ beyond %s tolerance %g\n",                           \
+                    message, #how, (double)(tolerance));                                                   \
+            gs_array_diff_report((actual), sizeof((actual)[0]), GS_KIND_OF((actual)[0]),                   \
+                                 (expected), sizeof((expected)[0]), GS_KIND_OF((expected)[0]),             \
+                                 _count, _mismatch, _differing, _differs);                                 \
             return 0;                                                                                      \
         } else {                                                                                           \
-            printf("PASS: %s\n", message);                                                                 \
+            GS_PASS("%s\n", message);                                                                      \
         }                                                                                                  \
     } while(0)
 
+#define TEST_ASSERT_FLOAT_ARRAY_EQ(actual, expected, size, epsilon, message)                               \
+    GS_ASSERT_FLOAT_ARRAY(actual, expected, size, abs, (double)(epsilon), message)
+
+#define TEST_ASSERT_FLOAT_ARRAY_ULP(actual, expected, size, max_ulps, message)                             \
+    GS_ASSERT_FLOAT_ARRAY(actual, expected, size, ulp, (unsigned long long)(max_ulps), message)
+
 // Floating point comparisons
 #define TEST_ASSERT_FLOAT_EQ(actual, expected, epsilon, message)                                           \
     do {                                                                                                   \
-        double _diff = (actual) - (expected);                                                              \
+        double _actual   = (actual);                                                                       \
+        double _expected = (expected);                                                                     \
+        double _diff = _actual - _expected;                                                                \
         if (_diff < 0) _diff = -_diff;                                                                     \
-        if (_diff > (epsilon)) {                                                                           \
-            fprintf(stderr, "FAIL: %s - Expected: %f, Got: %f (diff: %f)\n",                               \
-                    message, (double)(expected), (double)(actual), _diff);                                 \
+        if (GS_UNLIKELY(_diff > (epsilon))) {                                                              \
+            GS_ASSERT_FAILED(GS_FAIL_FLOAT_EQ, message, #actual " ~= " #expected, gs_value_double(_actual),\
+                             gs_value_double(_expected), gs_value_double(epsilon));                        \
             return 0;                                                                                      \
-        } else {                                                                                           \
-            printf("PASS: %s\n", message);                                                                 \
         }                                                                                                  \
+        GS_PASS("%s\n", message);                                                                          \
     } while(0)
 
 // Range testing
 #define TEST_ASSERT_IN_RANGE(value, min, max, message)                                                     \
     do {                                                                                                   \
-        if ((value) < (min) || (value) > (max)) {                                                          \
-            fprintf(stderr, "FAIL: %s - Value %d not in range [%d, %d]\n",                                 \
-                    message, (int)(value), (int)(min), (int)(max));                                        \
+        gs_value_t _v  = GS_VALUE(value);                                                                  \
+        gs_value_t _lo = GS_VALUE(min);                                                                    \
+        gs_value_t _hi = GS_VALUE(max);                                                                    \
+        int _below = gs_value_cmp(_v, _lo);                                                                \
+        int _above = gs_value_cmp(_v, _hi);                                                                \
+        if (GS_UNLIKELY(_below < 0 || _above == 1)) {                                                      \
+            GS_ASSERT_FAILED(GS_FAIL_IN_RANGE, message, #min " <= " #value " <= " #max, _v, _lo, _hi);     \
             return 0;                                                                                      \
-        } else {                                                                                           \
-            printf("PASS: %s\n", message);                                                                 \
         }                                                                                                  \
+        GS_PASS("%s\n", message);                                                                          \
     } while(0)
 
 // Skip test conditionally
@@ -483,61 +1408,3131 @@ typedef enum
 // File operations testing
 #define TEST_FILE_EXISTS(filepath, message)                                                                \
     do {                                                                                                   \
-        FILE *_f = fopen(filepath, "r");                                                                   \
-        if (_f == NULL) {                                                                                  \
-            fprintf(stderr, "FAIL: %s - File '%s' does not exist\n", message, filepath);                   \
+        const char *_path = (filepath);                                                                    \
+        FILE *_f = fopen(_path, "r");                                                                      \
+        if (GS_UNLIKELY(_f == NULL)) {                                                                     \
+            gs_value_t _p = gs_value_pointer(_path);                                                       \
+            GS_ASSERT_FAILED(GS_FAIL_FILE_EXISTS, message, #filepath, _p, _p, _p);                         \
             return 0;                                                                                      \
-        } else {                                                                                           \
-            fclose(_f);                                                                                    \
-            printf("PASS: %s\n", message);                                                                 \
         }                                                                                                  \
+        fclose(_f);                                                                                        \
+        GS_PASS("%s\n", message);                                                                          \
     } while(0)
 
-// Random testing helpers
-#define RANDOM_INT(min, max) ((rand() % ((max) - (min) + 1)) + (min))
-#define RANDOM_FLOAT() ((float)rand() / RAND_MAX)
+// Golden file and snapshot comparison
+//
+// TEST_ASSERT_FILE_EQ maps both files read-only and compares them in place, so no data is copied
+// through stdio buffers. A size mismatch is reported without reading more than needed; otherwise
+// the mappings are compared in 1 MiB chunks with memcmp, and only the chunk that differs is scanned
+// to find the first differing byte. The failure reports that offset, its line and column, and the
+// differing line from each side.
+//
+// TEST_ASSERT_SNAPSHOT(buffer, len, name) compares a buffer against GS_SNAPSHOT_DIR/name (default
+// directory "snapshots"). With GS_UPDATE_SNAPSHOTS=1 a differing or missing snapshot is rewritten
+// instead: the data goes to a temporary file that is fsynced and renamed over the old one, so an
+// interrupted run never leaves a truncated golden file behind.
 
-// Stress testing
-#define STRESS_TEST(iterations, test_code, message)                                                        \
+#define GS_COMPARE_CHUNK (1 << 20)
+
+/// ? A read-only mapping of a whole file; empty files map to a static empty buffer.
+typedef struct
+{
+    const unsigned char *data;
+    size_t               size;
+    int                  mapped;
+} gs_file_map_t;
+
+/// ? Maps path read-only. Returns 0 on success, -1 with errno set otherwise.
+static inline int gs_map_file(const char *path, gs_file_map_t *map) {
+    map->data   = (const unsigned char *)"";
+    map->size   = 0;
+    map->mapped = 0;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (st.st_size > 0) {
+        void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+        map->data   = data;
+        map->size   = (size_t)st.st_size;
+        map->mapped = 1;
+    }
+    close(fd);
+    return 0;
+}
+
+static inline void gs_unmap_file(gs_file_map_t *map) {
+    if (map->mapped) {
+        munmap((void *)map->data, map->size);
+    }
+    map->mapped = 0;
+}
+
+/// ? Offset of the first differing byte of two buffers, or SIZE_MAX if they are identical.
+static inline size_t gs_buffer_first_diff(const unsigned char *a, size_t a_len,
+                                          const unsigned char *b, size_t b_len) {
+    size_t common = a_len < b_len ? a_len : b_len;
+    for (size_t offset = 0; offset < common; offset += GS_COMPARE_CHUNK) {
+        size_t chunk = common - offset < GS_COMPARE_CHUNK ? common - offset : GS_COMPARE_CHUNK;
+        if (memcmp(a + offset, b + offset, chunk) != 0) {
+            size_t i = offset;
+            while (a[i] == b[i]) i++;
+            return i;
+        }
+    }
+    return a_len == b_len ? SIZE_MAX : common;
+}
+
+/// ? Prints the line containing offset (or the end of data), escaping unprintable bytes.
+static inline void gs_print_diff_line(const char *label, const unsigned char *data, size_t size, size_t offset) {
+    size_t start = offset < size ? offset : size;
+    while (start > 0 && data[start - 1] != '\n' && offset - start < 60) start--;
+    fprintf(stderr, "  %-10s%s\"", label, start > 0 && data[start - 1] != '\n' ? "..." : "");
+    size_t i = start;
+    for (; i < size && data[i] != '\n' && i - start < 120; i++) {
+        unsigned char c = data[i];
+        if (c == '"' || c == '\\') {
+            fprintf(stderr, "\\%c", c);
+        } else if (c >= 0x20 && c < 0x7f) {
+            fputc(c, stderr);
+        } else {
+            fprintf(stderr, "\\x%02x", c);
+        }
+    }
+    fprintf(stderr, "\"%s%s\n", i < size && data[i] != '\n' ? "..." : "", i >= size ? " <end of data>" : "");
+}
+
+/// ? Reports the first difference between actual and expected data, located at offset.
+static GS_COLD void gs_report_data_diff(const char *message, const char *expected_name,
+                                        const unsigned char *actual, size_t actual_size,
+                                        const unsigned char *expected, size_t expected_size, size_t offset) {
+    size_t line = 1, column = 1;
+    const unsigned char *p = expected;
+    const unsigned char *end = expected + (offset < expected_size ? offset : expected_size);
+    const unsigned char *nl;
+    while (p < end && (nl = memchr(p, '\n', (size_t)(end - p))) != NULL) {
+        line++;
+        p = nl + 1;
+    }
+    column += (size_t)(end - p);
+    if (actual_size != expected_size) {
+        fprintf(stderr, "FAIL: %s - Size differs from %s (expected %zu bytes, got %zu)\n",
+                message, expected_name, expected_size, actual_size);
+        fprintf(stderr, "  first difference at offset %zu (line %zu, column %zu)\n", offset, line, column);
+    } else {
+        fprintf(stderr, "FAIL: %s - Differs from %s at offset %zu (line %zu, column %zu)\n",
+                message, expected_name, offset, line, column);
+    }
+    gs_print_diff_line("expected:", expected, expected_size, offset);
+    gs_print_diff_line("actual:", actual, actual_size, offset);
+}
+
+static inline int gs_data_equal(const char *message, const char *expected_name,
+                                const void *actual, size_t actual_size,
+                                const void *expected, size_t expected_size) {
+    size_t offset = gs_buffer_first_diff(actual, actual_size, expected, expected_size);
+    if (GS_UNLIKELY(offset != SIZE_MAX)) {
+        gs_report_data_diff(message, expected_name, actual, actual_size, expected, expected_size, offset);
+        return 0;
+    }
+    return 1;
+}
+
+static inline int gs_file_equal(const char *actual_path, const char *expected_path, const char *message) {
+    gs_file_map_t actual, expected;
+    if (gs_map_file(actual_path, &actual) != 0) {
+        fprintf(stderr, "FAIL: %s - Cannot read '%s': %s\n", message, actual_path, strerror(errno));
+        return 0;
+    }
+    if (gs_map_file(expected_path, &expected) != 0) {
+        fprintf(stderr, "FAIL: %s - Cannot read '%s': %s\n", message, expected_path, strerror(errno));
+        gs_unmap_file(&actual);
+        return 0;
+    }
+    int equal = gs_data_equal(message, expected_path, actual.data, actual.size, expected.data, expected.size);
+    gs_unmap_file(&actual);
+    gs_unmap_file(&expected);
+    return equal;
+}
+
+/// ? Creates every missing parent directory of path.
+static inline void gs_mkdir_parents(const char *path) {
+    char dir[1024];
+    snprintf(dir, sizeof(dir), "%s", path);
+    for (char *slash = strchr(dir + 1, '/'); slash; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        mkdir(dir, 0755);
+        *slash = '/';
+    }
+}
+
+/// ? Replaces path with data via a fsynced temporary file and rename(). Returns 0 on success.
+static inline int gs_write_file_atomic(const char *path, const void *data, size_t size) {
+    char tmp[1100];
+    snprintf(tmp, sizeof(tmp), "%s.tmp.%ld", path, (long)getpid());
+    gs_mkdir_parents(path);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    const char *p = data;
+    size_t left = size;
+    while (left > 0) {
+        ssize_t written = write(fd, p, left);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) break;
+        p += written;
+        left -= (size_t)written;
+    }
+    if (left > 0 || fsync(fd) != 0) {
+        close(fd);
+        unlink(tmp);
+        return -1;
+    }
+    close(fd);
+    if (rename(tmp, path) != 0) {
+        unlink(tmp);
+        return -1;
+    }
+    /// ? Persist the rename itself by syncing the containing directory
+    char dir[1024];
+    snprintf(dir, sizeof(dir), "%s", path);
+    char *slash = strrchr(dir, '/');
+    if (slash) *slash = '\0'; else snprintf(dir, sizeof(dir), ".");
+    int dir_fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    return 0;
+}
+
+static inline int gs_snapshot_check(const void *buffer, size_t len, const char *name) {
+    const char *dir = getenv("GS_SNAPSHOT_DIR");
+    const char *update = getenv("GS_UPDATE_SNAPSHOTS");
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", dir && *dir ? dir : "snapshots", name);
+
+    gs_file_map_t golden;
+    int have_golden = gs_map_file(path, &golden) == 0;
+    int equal = have_golden && gs_buffer_first_diff(buffer, len, golden.data, golden.size) == SIZE_MAX;
+    if (equal || !(update && *update && strcmp(update, "0") != 0)) {
+        if (!have_golden) {
+            fprintf(stderr, "FAIL: snapshot %s - Cannot read '%s': %s\n", name, path, strerror(errno));
+            fprintf(stderr, "  run with GS_UPDATE_SNAPSHOTS=1 to create it\n");
+        } else if (!equal) {
+            gs_data_equal(name, path, buffer, len, golden.data, golden.size);
+            fprintf(stderr, "  run with GS_UPDATE_SNAPSHOTS=1 to accept the new output\n");
+        }
+        gs_unmap_file(&golden);
+        return equal;
+    }
+    gs_unmap_file(&golden);
+    if (gs_write_file_atomic(path, buffer, len) != 0) {
+        fprintf(stderr, "FAIL: snapshot %s - Cannot write '%s': %s\n", name, path, strerror(errno));
+        return 0;
+    }
+    printf("SNAPSHOT: %s %s (%zu bytes)\n", have_golden ? "updated" : "created", path, len);
+    return 1;
+}
+
+#define TEST_ASSERT_FILE_EQ(actual_path, expected_path, message)                                           \
     do {                                                                                                   \
-        printf("STRESS TEST: %s (%d iterations)\n", message, iterations);                                  \
-        int _failures = 0;                                                                                 \
-        for (int _i = 0; _i < (iterations); _i++) {                                                        \
-            if (!(test_code)) {                                                                            \
-                _failures++;                                                                               \
-            }                                                                                              \
-        }                                                                                                  \
-        if (_failures > 0) {                                                                               \
-            fprintf(stderr, "STRESS TEST FAIL: %d/%d iterations failed\n", _failures, iterations);         \
+        if (!gs_file_equal((actual_path), (expected_path), message)) {                                     \
             return 0;                                                                                      \
-        } else {                                                                                           \
-            printf("STRESS TEST PASS: All %d iterations passed\n", iterations);                            \
         }                                                                                                  \
+        GS_PASS("%s\n", message);                                                                          \
     } while(0)
 
-// Enhanced debugging
-#define TRACE_FUNCTION()                                                                                   \
+#define TEST_ASSERT_SNAPSHOT(buffer, len, name)                                                            \
     do {                                                                                                   \
-        if (getenv("TRACE")) {                                                                             \
-            fprintf(stderr, "TRACE: Entering %s (%s:%d)\n", __func__, __FILE__, __LINE__);                 \
+        if (!gs_snapshot_check((buffer), (len), name)) {                                                   \
+            return 0;                                                                                      \
         }                                                                                                  \
+        GS_PASS("snapshot %s\n", name);                                                                    \
     } while(0)
 
-#define LOG_VAR(var)                                                                                       \
+// Shared fixtures
+//
+// FIXTURE_GET(name, source_path, build_fn, &len) returns a read-only, zero-copy view of a dataset
+// that is built at most once. build_fn(source_path, out) writes the dataset to `out` and returns 0
+// on success. With a source path the result is cached on disk in GS_FIXTURE_DIR (default
+// "fixture_cache") behind a header recording the source's size, mtime, device and inode, and later
+// runs and other worker processes map the cached file directly. A lock file serialises concurrent
+// builds of the same fixture. Passing a NULL build_fn maps the source file itself. Without a
+// source path the dataset is built into a memfd, which lives as long as the process.
+//
+// The cache cannot tell when build_fn itself changes. FIXTURE_GET_VERSION(name, source_path,
+// build_fn, version, &len) stores a caller-chosen version in the header; bump it whenever build_fn
+// or its output format changes. FIXTURE_GET uses version 0.
+//
+// Every mapping is MAP_SHARED, so workers forked after FIXTURE_GET share its pages instead of
+// copying them. Each call stats the source, and a change to its size, mtime, device or inode (or to
+// the version) rebuilds the fixture; pointers returned before the rebuild are no longer valid after it.
+
+#define GS_FIXTURE_MAX   64
+#define GS_FIXTURE_MAGIC "GSFIX002"
+
+/// ? Writes the fixture built from `source` (NULL for memfd fixtures) to `out`; returns 0 on success.
+typedef int (*gs_fixture_build_t)(const char *source, FILE *out);
+
+/// ? On-disk header of a cached fixture; the data follows it, 64-byte aligned.
+typedef struct
+{
+    char     magic[8];
+    uint64_t source_size;
+    int64_t  source_mtime_sec;
+    int64_t  source_mtime_nsec;
+    uint64_t source_ino;
+    uint64_t data_size;
+    uint64_t source_dev;
+    uint64_t build_version;   /// ? caller's version of build_fn and its output format
+} gs_fixture_header_t;
+
+typedef struct
+{
+    char         name[128];
+    char         source[512];
+    struct stat  source_stat;  /// ? what the mapping was built from
+    uint64_t     version;
+    void        *map;
+    size_t       map_size;
+    const void  *data;
+    size_t       size;
+} gs_fixture_t;
+
+static gs_fixture_t    gs_fixtures[GS_FIXTURE_MAX];
+static int             gs_fixture_count = 0;
+static pthread_mutex_t gs_fixture_lock  = PTHREAD_MUTEX_INITIALIZER;
+
+static inline int gs_fixture_source_changed(const struct stat *a, const struct stat *b) {
+    return a->st_size != b->st_size || a->st_ino != b->st_ino || a->st_dev != b->st_dev ||
+           a->st_mtim.tv_sec != b->st_mtim.tv_sec || a->st_mtim.tv_nsec != b->st_mtim.tv_nsec;
+}
+
+static inline int gs_fixture_header_matches(const gs_fixture_header_t *h, const struct stat *st, uint64_t version) {
+    return memcmp(h->magic, GS_FIXTURE_MAGIC, sizeof(h->magic)) == 0 &&
+           h->source_size == (uint64_t)st->st_size && h->source_ino == (uint64_t)st->st_ino &&
+           h->source_dev == (uint64_t)st->st_dev &&
+           h->source_mtime_sec == (int64_t)st->st_mtim.tv_sec &&
+           h->source_mtime_nsec == (int64_t)st->st_mtim.tv_nsec &&
+           h->build_version == version;
+}
+
+/// ? Runs build into fd starting at its current offset; returns the number of bytes written or -1.
+static inline off_t gs_fixture_build_into(int fd, const char *name, const char *source, gs_fixture_build_t build) {
+    off_t start = lseek(fd, 0, SEEK_CUR);
+    int out_fd = dup(fd);
+    FILE *out = out_fd >= 0 ? fdopen(out_fd, "w") : NULL;
+    if (out == NULL) {
+        if (out_fd >= 0) close(out_fd);
+        fprintf(stderr, "ERROR: fixture %s: cannot open output: %s\n", name, strerror(errno));
+        return -1;
+    }
+    int rc = build(source, out);
+    int write_error = ferror(out);
+    if (fclose(out) != 0 || write_error || rc != 0) {
+        fprintf(stderr, "ERROR: fixture %s: build failed (returned %d%s)\n",
+                name, rc, write_error ? ", write error" : "");
+        return -1;
+    }
+    return lseek(fd, 0, SEEK_END) - start;
+}
+
+/// ? Maps a cached fixture file if its header matches the source; returns 0 on success.
+static inline int gs_fixture_map_cache(gs_fixture_t *f, const char *path, const struct stat *source_stat) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    gs_fixture_header_t header;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(header) ||
+        pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        !gs_fixture_header_matches(&header, source_stat, f->version) ||
+        header.data_size != (uint64_t)st.st_size - sizeof(header)) {
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    f->map      = map;
+    f->map_size = (size_t)st.st_size;
+    f->data     = (const char *)map + sizeof(header);
+    f->size     = (size_t)header.data_size;
+    return 0;
+}
+
+/// ? Builds the fixture for source into the cache (unless another process just did) and maps it.
+static inline int gs_fixture_load_cached(gs_fixture_t *f, const struct stat *source_stat, gs_fixture_build_t build) {
+    const char *dir = getenv("GS_FIXTURE_DIR");
+    char path[1024], lock_path[1100], tmp[1100];
+    snprintf(path, sizeof(path), "%s/%s", dir && *dir ? dir : "fixture_cache", f->name);
+    snprintf(lock_path, sizeof(lock_path), "%s.lock", path);
+    snprintf(tmp, sizeof(tmp), "%s.tmp.%ld", path, (long)getpid());
+    gs_mkdir_parents(path);
+
+    int lock_fd = open(lock_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (lock_fd >= 0) {
+        flock(lock_fd, LOCK_EX);
+    }
+    int rc = gs_fixture_map_cache(f, path, source_stat);
+    if (rc != 0) {
+        int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        gs_fixture_header_t header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, GS_FIXTURE_MAGIC, sizeof(header.magic));
+        header.source_size       = (uint64_t)source_stat->st_size;
+        header.source_mtime_sec  = (int64_t)source_stat->st_mtim.tv_sec;
+        header.source_mtime_nsec = (int64_t)source_stat->st_mtim.tv_nsec;
+        header.source_ino        = (uint64_t)source_stat->st_ino;
+        header.source_dev        = (uint64_t)source_stat->st_dev;
+        header.build_version     = f->version;
+        off_t built = -1;
+        if (fd < 0) {
+            fprintf(stderr, "ERROR: fixture %s: cannot create '%s': %s\n", f->name, tmp, strerror(errno));
+        } else if (lseek(fd, (off_t)sizeof(header), SEEK_SET) >= 0) {
+            built = gs_fixture_build_into(fd, f->name, f->source, build);
+        }
+        if (built >= 0) {
+            header.data_size = (uint64_t)built;
+            if (pwrite(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) && rename(tmp, path) == 0) {
+                rc = gs_fixture_map_cache(f, path, source_stat);
+            }
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+        unlink(tmp);
+    }
+    if (lock_fd >= 0) {
+        flock(lock_fd, LOCK_UN);
+        close(lock_fd);
+    }
+    return rc;
+}
+
+/// ? Builds a source-less fixture into a memfd and maps it; returns 0 on success.
+static inline int gs_fixture_load_memfd(gs_fixture_t *f, gs_fixture_build_t build) {
+#ifdef MFD_CLOEXEC
+    int fd = memfd_create(f->name, MFD_CLOEXEC);
+#else
+    FILE *tmp = tmpfile();
+    int fd = tmp ? dup(fileno(tmp)) : -1;
+    if (tmp) fclose(tmp);
+#endif
+    if (fd < 0) {
+        fprintf(stderr, "ERROR: fixture %s: cannot create memory file: %s\n", f->name, strerror(errno));
+        return -1;
+    }
+    off_t built = gs_fixture_build_into(fd, f->name, NULL, build);
+    void *map = built > 0 ? mmap(NULL, (size_t)built, PROT_READ, MAP_SHARED, fd, 0) : NULL;
+    close(fd);
+    if (built < 0 || map == MAP_FAILED) {
+        return -1;
+    }
+    f->map      = map;
+    f->map_size = (size_t)built;
+    f->data     = map ? map : (const void *)"";
+    f->size     = (size_t)built;
+    return 0;
+}
+
+/// ? Maps the source file itself, for fixtures that need no build step.
+static inline int gs_fixture_load_source(gs_fixture_t *f) {
+    gs_file_map_t map;
+    if (gs_map_file(f->source, &map) != 0) {
+        fprintf(stderr, "ERROR: fixture %s: cannot map '%s': %s\n", f->name, f->source, strerror(errno));
+        return -1;
+    }
+    /// ? gs_map_file maps privately; read-only private pages are still shared until written
+    f->map      = map.mapped ? (void *)map.data : NULL;
+    f->map_size = map.size;
+    f->data     = map.data;
+    f->size     = map.size;
+    return 0;
+}
+
+static inline const void *gs_fixture_get(const char *name, const char *source, gs_fixture_build_t build,
+                                         uint64_t version, size_t *len) {
+    if (len) *len = 0;
+    if (source == NULL && build == NULL) {
+        fprintf(stderr, "ERROR: fixture %s: needs a source path or a build function\n", name);
+        return NULL;
+    }
+    struct stat source_stat;
+    memset(&source_stat, 0, sizeof(source_stat));
+    if (source && stat(source, &source_stat) != 0) {
+        fprintf(stderr, "ERROR: fixture %s: cannot stat '%s': %s\n", name, source, strerror(errno));
+        return NULL;
+    }
+
+    pthread_mutex_lock(&gs_fixture_lock);
+    gs_fixture_t *f = NULL;
+    for (int i = 0; i < gs_fixture_count; i++) {
+        if (strcmp(gs_fixtures[i].name, name) == 0) {
+            f = &gs_fixtures[i];
+            break;
+        }
+    }
+    if (f && f->data && f->version == version &&
+        !(source && (strcmp(f->source, source) != 0 || gs_fixture_source_changed(&f->source_stat, &source_stat)))) {
+        if (len) *len = f->size;
+        pthread_mutex_unlock(&gs_fixture_lock);
+        return f->data;
+    }
+    if (f == NULL) {
+        if (gs_fixture_count == GS_FIXTURE_MAX) {
+            pthread_mutex_unlock(&gs_fixture_lock);
+            fprintf(stderr, "ERROR: fixture %s: more than %d fixtures registered\n", name, GS_FIXTURE_MAX);
+            return NULL;
+        }
+        f = &gs_fixtures[gs_fixture_count++];
+        snprintf(f->name, sizeof(f->name), "%s", name);
+    } else if (f->map) {
+        munmap(f->map, f->map_size);
+    }
+    f->map  = NULL;
+    f->data = NULL;
+    f->size = 0;
+    snprintf(f->source, sizeof(f->source), "%s", source ? source : "");
+    f->source_stat = source_stat;
+    f->version     = version;
+
+    int rc = source == NULL ? gs_fixture_load_memfd(f, build)
+           : build == NULL  ? gs_fixture_load_source(f)
+                            : gs_fixture_load_cached(f, &source_stat, build);
+    const void *data = rc == 0 ? f->data : NULL;
+    if (len && data) *len = f->size;
+    pthread_mutex_unlock(&gs_fixture_lock);
+    return data;
+}
+
+#define FIXTURE_GET(name, source_path, build_fn, len_ptr)                                                  \
+    gs_fixture_get((name), (source_path), (build_fn), 0, (len_ptr))
+
+#define FIXTURE_GET_VERSION(name, source_path, build_fn, version, len_ptr)                                 \
+    gs_fixture_get((name), (source_path), (build_fn), (uint64_t)(version), (len_ptr))
+
+// Random testing helpers
+//
+// Each thread owns a xoshiro256++ generator, so RANDOM_* never takes a lock and threads do not share
+// a sequence. All generators derive from one 64-bit seed: GS_SEED from the environment, RANDOM_SEED(),
+// or the clock. Once anything has drawn from it, failing tests print the seed so the run can be
+// repeated with GS_SEED=<seed>. Thread streams are numbered in the order threads first draw.
+//
+// Bounded integers use Lemire's multiply-shift rejection method and are unbiased for any range.
+// RANDOM_FILL and RANDOM_FILL_DOUBLE run four independent generators side by side so the compiler can
+// vectorize them for large random fixtures.
+
+static unsigned long long           gs_seed         = 0;
+static int                          gs_seed_ready   = 0;
+static int                          gs_rng_used     = 0;    /// ? set once the current test draws a random value
+static int                          gs_seed_printed = 0;    /// ? seed already shown for the current test
+static unsigned int                 gs_rng_epoch    = 1;    /// ? bumped by RANDOM_SEED to reseed every thread
+static unsigned int                 gs_rng_streams  = 0;
+static unsigned int                 gs_alloc_streams = 0;   /// ? same numbering for allocation-failure draws
+static __thread uint64_t            gs_rng_state[4];
+static __thread unsigned int        gs_rng_local_epoch = 0;
+
+static inline uint64_t gs_splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t gs_rotl64(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline unsigned long long gs_rand_seed(void) {
+    if (!gs_seed_ready) {
+        const char *env = getenv("GS_SEED");
+        if (env) {
+            gs_seed = strtoull(env, NULL, 0);
+        } else {
+            struct timespec now;
+            clock_gettime(CLOCK_REALTIME, &now);
+            uint64_t mix = ((uint64_t)now.tv_sec << 32) ^ (uint64_t)now.tv_nsec ^ ((uint64_t)getpid() << 16);
+            gs_seed = gs_splitmix64(&mix);
+        }
+        gs_seed_ready = 1;
+    }
+    return gs_seed;
+}
+
+static inline void gs_rand_seed_thread(void) {
+    uint64_t stream = __atomic_fetch_add(&gs_rng_streams, 1, __ATOMIC_RELAXED);
+    uint64_t x = gs_rand_seed() ^ (stream * 0xD1B54A32D192ED03ULL);
+    for (int i = 0; i < 4; i++) {
+        gs_rng_state[i] = gs_splitmix64(&x);
+    }
+    gs_rng_local_epoch = __atomic_load_n(&gs_rng_epoch, __ATOMIC_ACQUIRE);
+}
+
+static inline uint64_t gs_rand_u64(void) {
+    if (__builtin_expect(gs_rng_local_epoch != __atomic_load_n(&gs_rng_epoch, __ATOMIC_RELAXED), 0)) {
+        gs_rand_seed_thread();
+    }
+    /// ? Stress workers draw concurrently; store only on the first draw so the flag stays uncontended
+    if (__builtin_expect(!__atomic_load_n(&gs_rng_used, __ATOMIC_RELAXED), 0)) {
+        __atomic_store_n(&gs_rng_used, 1, __ATOMIC_RELAXED);
+    }
+
+    uint64_t *s = gs_rng_state;
+    uint64_t result = gs_rotl64(s[0] + s[3], 23) + s[0];
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = gs_rotl64(s[3], 45);
+    return result;
+}
+
+/// ? Uniform value in [0, range); range 0 means the full 64-bit range.
+static inline uint64_t gs_rand_below(uint64_t range) {
+    if (range == 0) {
+        return gs_rand_u64();
+    }
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 gs_u128;   /// ? quiet under -pedantic
+    gs_u128 m = (gs_u128)gs_rand_u64() * range;
+    uint64_t low = (uint64_t)m;
+    if (low < range) {
+        uint64_t threshold = -range % range;
+        while (low < threshold) {
+            m = (gs_u128)gs_rand_u64() * range;
+            low = (uint64_t)m;
+        }
+    }
+    return (uint64_t)(m >> 64);
+#else
+    uint64_t threshold = -range % range;
+    uint64_t x;
+    do {
+        x = gs_rand_u64();
+    } while (x < threshold);
+    return x % range;
+#endif
+}
+
+/// ? Uniform integer in [min, max], both inclusive.
+static inline long long gs_rand_range(long long min, long long max) {
+    uint64_t span = (uint64_t)max - (uint64_t)min + 1;
+    return (long long)((uint64_t)min + gs_rand_below(span));
+}
+
+/// ? Uniform double in [0, 1) with 53 random bits.
+static inline double gs_rand_double(void) {
+    return (double)(gs_rand_u64() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/// ? Four xoshiro256++ generators stored lane by lane, stepped together for bulk fills.
+typedef struct
+{
+    uint64_t s0[4], s1[4], s2[4], s3[4];
+} gs_rand_lanes_t;
+
+static inline void gs_rand_lanes_init(gs_rand_lanes_t *lanes) {
+    uint64_t x = gs_rand_u64();
+    for (int l = 0; l < 4; l++) {
+        lanes->s0[l] = gs_splitmix64(&x);
+        lanes->s1[l] = gs_splitmix64(&x);
+        lanes->s2[l] = gs_splitmix64(&x);
+        lanes->s3[l] = gs_splitmix64(&x);
+    }
+}
+
+static inline void gs_rand_lanes_next(gs_rand_lanes_t *lanes, uint64_t out[4]) {
+    for (int l = 0; l < 4; l++) {
+        uint64_t s0 = lanes->s0[l], s1 = lanes->s1[l], s2 = lanes->s2[l], s3 = lanes->s3[l];
+        out[l] = ((s0 + s3) << 23 | (s0 + s3) >> 41) + s0;
+        uint64_t t = s1 << 17;
+        s2 ^= s0;
+        s3 ^= s1;
+        s1 ^= s2;
+        s0 ^= s3;
+        s2 ^= t;
+        s3 = s3 << 45 | s3 >> 19;
+        lanes->s0[l] = s0; lanes->s1[l] = s1; lanes->s2[l] = s2; lanes->s3[l] = s3;
+    }
+}
+
+static inline void gs_rand_fill(void *buffer, size_t size) {
+    gs_rand_lanes_t lanes;
+    gs_rand_lanes_init(&lanes);
+    unsigned char *out = buffer;
+    uint64_t block[4];
+    while (size >= sizeof(block)) {
+        gs_rand_lanes_next(&lanes, block);
+        memcpy(out, block, sizeof(block));
+        out  += sizeof(block);
+        size -= sizeof(block);
+    }
+    if (size > 0) {
+        gs_rand_lanes_next(&lanes, block);
+        memcpy(out, block, size);
+    }
+}
+
+static inline void gs_rand_fill_double(double *out, size_t count) {
+    gs_rand_lanes_t lanes;
+    gs_rand_lanes_init(&lanes);
+    uint64_t block[4];
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        gs_rand_lanes_next(&lanes, block);
+        for (int l = 0; l < 4; l++) {
+            out[i + l] = (double)(block[l] >> 11) * (1.0 / 9007199254740992.0);
+        }
+    }
+    for (; i < count; i++) {
+        out[i] = gs_rand_double();
+    }
+}
+
+#define RANDOM_SEED(seed)                                                                                  \
     do {                                                                                                   \
-        if (getenv("DEBUG")) {                                                                             \
-            fprintf(stderr, "DEBUG: %s = %d (%s:%d)\n", #var, (int)(var), __FILE__, __LINE__);             \
-        }                                                                                                  \
+        gs_seed        = (unsigned long long)(seed);                                                       \
+        gs_seed_ready  = 1;                                                                                \
+        gs_rng_streams = 0;                                                                                \
+        gs_alloc_streams = 0;                                                                              \
+        __atomic_add_fetch(&gs_rng_epoch, 1, __ATOMIC_RELEASE);                                            \
     } while(0)
 
-// Buffer overflow protection testing
-#define TEST_BUFFER_OVERFLOW(buffer, size, write_size, message)                                            \
+#define RANDOM_INT(min, max)             ((int)gs_rand_range((min), (max)))
+#define RANDOM_FLOAT()                   ((float)(gs_rand_u64() >> 40) * (1.0f / 16777216.0f))
+#define RANDOM_DOUBLE()                  gs_rand_double()
+#define RANDOM_FILL(buffer, size)        gs_rand_fill((buffer), (size))
+#define RANDOM_FILL_DOUBLE(buffer, n)    gs_rand_fill_double((buffer), (n))
+
+/// ? Printed with failures so a randomized run can be repeated exactly
+#define GS_PRINT_SEED()                                                                                    \
     do {                                                                                                   \
-        if ((write_size) > (size)) {                                                                       \
-            fprintf(stderr, "FAIL: %s - Buffer overflow detected (writing %d bytes to %d byte buffer)\n",  \
-                    message, (int)(write_size), (int)(size));                                              \
-            return 0;                                                                                      \
-        } else {                                                                                           \
-            printf("PASS: %s\n", message);                                                                 \
+        if (__atomic_load_n(&gs_rng_used, __ATOMIC_RELAXED) && !gs_seed_printed) {                         \
+            printf("  reproduce with GS_SEED=%llu\n", gs_rand_seed());                                     \
+            gs_seed_printed = 1;                                                                           \
         }                                                                                                  \
     } while(0)
+
+// Suite setup and teardown
+//
+// SUITE_SETUP(code) runs once and builds state that several tests need; SUITE_TEARDOWN(code)
+// releases it after the last one. RUN_SUITE_TEST(test_func) runs each test in a child forked from
+// the process that ran SUITE_SETUP, so every test starts from a pristine copy-on-write view of the
+// suite state, however expensive it was to build, and mutations never leak into the next test.
+//
+// The child reports through its exit status: 0 when the test passed, 1 when it returned 0. Any
+// other status, or death by a signal, is reported as a crash without taking the suite down. Passing
+// assertions and the random seed are handed back through a shared page, and the child's resource
+// usage is collected with wait4().
+
+/// ? What a suite test child hands back to the parent
+typedef struct
+{
+    long               assertions_passed;
+    int                rng_used;
+    unsigned long long seed;
+} gs_suite_result_t;
+
+static gs_suite_result_t *gs_suite_result = NULL;
+
+#define SUITE_SETUP(setup_code)                                                                            \
+    do {                                                                                                   \
+        printf("Setting up suite...\n");                                                                   \
+        setup_code;                                                                                        \
+    } while(0)
+
+#define SUITE_TEARDOWN(teardown_code)                                                                      \
+    do {                                                                                                   \
+        printf("Tearing down suite...\n");                                                                 \
+        teardown_code;                                                                                     \
+    } while(0)
+
+/// ? Runs test in a forked child; returns its wait status (-1 if fork failed), rusage and I/O bytes.
+static inline int gs_suite_run_child(int (*test)(void), struct rusage *usage,
+                                     long long *read_bytes, long long *write_bytes) {
+    if (gs_suite_result == NULL) {
+        void *page = mmap(NULL, sizeof(*gs_suite_result), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        gs_suite_result = page == MAP_FAILED ? NULL : page;
+    }
+    if (gs_suite_result == NULL) {
+        return -1;
+    }
+    memset(gs_suite_result, 0, sizeof(*gs_suite_result));
+    memset(usage, 0, sizeof(*usage));
+    *read_bytes = *write_bytes = 0;
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid < 0) {
+        return -1;
+    }
+    if (pid == 0) {
+        long passed_before = gs_assertions_passed;
+        int passed = test();
+        gs_suite_result->assertions_passed = gs_assertions_passed - passed_before;
+        gs_suite_result->rng_used          = gs_rng_used;
+        gs_suite_result->seed              = gs_rng_used ? gs_rand_seed() : 0;
+        fflush(NULL);
+        /// ? _exit skips atexit handlers (heap profile dumps, ...) that belong to the parent
+        _exit(passed ? 0 : 1);
+    }
+    /// ? The child's /proc entry stays readable until it is reaped
+    siginfo_t info;
+    while (waitid(P_PID, (id_t)pid, &info, WEXITED | WNOWAIT) < 0 && errno == EINTR) {
+    }
+    char io_path[64];
+    snprintf(io_path, sizeof(io_path), "/proc/%ld/io", (long)pid);
+    gs_read_proc_io(io_path, read_bytes, write_bytes);
+    int status = 0;
+    while (wait4(pid, &status, 0, usage) < 0 && errno == EINTR) {
+    }
+    gs_assertions_passed += gs_suite_result->assertions_passed;
+    return status;
+}
+
+#define RUN_SUITE_TEST(test_func)                                                                          \
+    do {                                                                                                   \
+        gs_test_begin(#test_func);                                                                         \
+        gs_seed_printed = 0;                                                                               \
+        gs_rng_used = 0;                                                                                   \
+        struct rusage _usage;                                                                              \
+        long long _read_bytes, _write_bytes;                                                               \
+        int _status = gs_suite_run_child(test_func, &_usage, &_read_bytes, &_write_bytes);                 \
+        int _passed = _status != -1 && WIFEXITED(_status) && WEXITSTATUS(_status) == 0;                    \
+        gs_test_record(_passed, &_usage, _read_bytes, _write_bytes);                                       \
+        if (_passed) {                                                                                     \
+            printf("✓ %s passed (%ld KB peak RSS)\n\n", #test_func, _usage.ru_maxrss);                     \
+        } else {                                                                                           \
+            if (_status == -1) {                                                                           \
+                printf("✗ %s failed (fork() failed)\n", #test_func);                                       \
+            } else if (WIFEXITED(_status) && WEXITSTATUS(_status) == 1) {                                  \
+                printf("✗ %s failed\n", #test_func);                                                       \
+            } else {                                                                                       \
+                printf("✗ %s crashed (%s)\n", #test_func, gs_crash_describe(_status));                     \
+            }                                                                                              \
+            if (gs_suite_result && gs_suite_result->rng_used) {                                            \
+                printf("  reproduce with GS_SEED=%llu\n", gs_suite_result->seed);                          \
+            }                                                                                              \
+            printf("\n");                                                                                  \
+        }                                                                                                  \
+    } while(0)
+
+// Stress testing
+#define STRESS_TEST(iterations, test_code, message)                                                        \
+    do {                                                                                                   \
+        printf("STRESS TEST: %s (%d iterations)\n", message, iterations);                                  \
+        int _failures = 0;                                                                                 \
+        for (int _i = 0; _i < (iterations); _i++) {                                                        \
+            if (!(test_code)) {                                                                            \
+                _failures++;                                                                               \
+            }                                                                                              \
+        }                                                                                                  \
+        if (_failures > 0) {                                                                               \
+            fprintf(stderr, "STRESS TEST FAIL: %d/%d iterations failed\n", _failures, iterations);         \
+            GS_PRINT_SEED();                                                                               \
+            return 0;                                                                                      \
+        } else {                                                                                           \
+            printf("STRESS TEST PASS: All %d iterations passed\n", iterations);                            \
+        }                                                                                                  \
+    } while(0)
+
+// Time-bounded soak testing
+//
+// SOAK_TEST(seconds, test_code, message) is STRESS_TEST with a duration instead of an iteration count,
+// and REPEAT_FOR(seconds, test_code) is the duration version of REPEAT_TEST. The clock is only read
+// between batches of iterations; the batch size adapts so that happens about once a millisecond.
+// Every GS_SOAK_INTERVAL seconds (default: a twentieth of the run, 1..60 s) a line with ops/sec and
+// error rate is printed. At the end, if the last three intervals ran GS_SOAK_DEGRADE (default 0.2)
+// slower than the first three, a warning points at fragmentation or leaks. Ctrl-C ends the soak
+// early with a normal summary. The previous SIGINT handler comes back when the soak ends, including
+// when the body leaves it with `return` (a failing TEST_ASSERT, say), in which case no summary is
+// printed.
+
+#define GS_SOAK_MAX_BATCH (1 << 20)
+
+typedef struct
+{
+    const char      *name;
+    double           seconds;
+    double           interval;
+    double           elapsed;
+    double           next_report;
+    double           last_check;
+    struct timespec  start;
+    long long        iterations;
+    long long        failures;
+    long long        batch_failures;        /// ? failures counted by the macro in the current batch
+    long long        interval_iterations;
+    long long        interval_failures;
+    int              batch;
+    int              intervals;
+    double           first_rates[3];
+    double           last_rates[3];
+    struct sigaction previous_sigint;
+    int              sigint_installed;
+} gs_soak_t;
+
+static volatile sig_atomic_t gs_soak_interrupted = 0;
+
+static inline void gs_soak_sigint(int sig) {
+    (void)sig;
+    gs_soak_interrupted = 1;
+}
+
+static inline double gs_soak_now(const gs_soak_t *soak) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - soak->start.tv_sec) + (double)(now.tv_nsec - soak->start.tv_nsec) / 1e9;
+}
+
+static inline void gs_soak_begin(gs_soak_t *soak, double seconds, const char *name) {
+    memset(soak, 0, sizeof(*soak));
+    soak->name    = name;
+    soak->seconds = seconds;
+    soak->batch   = 1;
+
+    const char *interval = getenv("GS_SOAK_INTERVAL");
+    soak->interval = interval ? atof(interval) : seconds / 20.0;
+    if (!interval && soak->interval < 1.0)  soak->interval = 1.0;
+    if (!interval && soak->interval > 60.0) soak->interval = 60.0;
+    soak->next_report = soak->interval;
+
+    gs_soak_interrupted = 0;
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = gs_soak_sigint;
+    soak->sigint_installed = sigaction(SIGINT, &action, &soak->previous_sigint) == 0;
+
+    printf("SOAK TEST: %s (%.0f seconds)\n", name, seconds);
+    fflush(stdout);
+    clock_gettime(CLOCK_MONOTONIC, &soak->start);
+}
+
+/// ? Called after every batch; returns 0 once the time is up or SIGINT arrived.
+static inline int gs_soak_tick(gs_soak_t *soak) {
+    soak->iterations          += soak->batch;
+    soak->interval_iterations += soak->batch;
+    soak->failures            += soak->batch_failures;
+    soak->interval_failures   += soak->batch_failures;
+    soak->batch_failures       = 0;
+
+    double now = gs_soak_now(soak);
+    double since_check = now - soak->last_check;
+    soak->last_check = now;
+    if (since_check < 0.0005 && soak->batch < GS_SOAK_MAX_BATCH) {
+        soak->batch *= 2;
+    } else if (since_check > 0.002 && soak->batch > 1) {
+        soak->batch /= 2;
+    }
+
+    if (now >= soak->next_report || now >= soak->seconds || gs_soak_interrupted) {
+        double span = now - (soak->next_report - soak->interval);
+        double rate = span > 0 ? soak->interval_iterations / span : 0.0;
+        if (soak->intervals < 3) {
+            soak->first_rates[soak->intervals] = rate;
+        }
+        soak->last_rates[soak->intervals % 3] = rate;
+        soak->intervals++;
+
+        printf("  [%7.1fs] %.0f ops/s, errors %.2f%% (%lld ops total)\n", now, rate,
+               soak->interval_iterations ? 100.0 * soak->interval_failures / soak->interval_iterations : 0.0,
+               soak->iterations);
+        fflush(stdout);
+        soak->interval_iterations = 0;
+        soak->interval_failures   = 0;
+        soak->next_report         = now + soak->interval;
+    }
+
+    soak->elapsed = now;
+    return now < soak->seconds && !gs_soak_interrupted;
+}
+
+/// ? Puts the previous SIGINT handler back; also the cleanup for a soak left early by `return`.
+static inline void gs_soak_restore_sigint(gs_soak_t *soak) {
+    if (soak->sigint_installed) {
+        sigaction(SIGINT, &soak->previous_sigint, NULL);
+        soak->sigint_installed = 0;
+        gs_soak_interrupted = 0;
+    }
+}
+
+/// ? Restores SIGINT and prints the summary; returns the number of failed iterations.
+static inline long long gs_soak_end(gs_soak_t *soak) {
+    int interrupted = gs_soak_interrupted;
+    gs_soak_restore_sigint(soak);
+
+    printf("SOAK SUMMARY: %s - %lld ops in %.1fs (%.0f ops/s), %lld errors (%.4f%%)%s\n",
+           soak->name, soak->iterations, soak->elapsed,
+           soak->elapsed > 0 ? soak->iterations / soak->elapsed : 0.0, soak->failures,
+           soak->iterations ? 100.0 * soak->failures / soak->iterations : 0.0,
+           interrupted ? ", interrupted" : "");
+
+    if (soak->intervals >= 6) {
+        const char *threshold_env = getenv("GS_SOAK_DEGRADE");
+        double threshold = threshold_env ? atof(threshold_env) : 0.2;
+        double first = (soak->first_rates[0] + soak->first_rates[1] + soak->first_rates[2]) / 3.0;
+        double last  = (soak->last_rates[0] + soak->last_rates[1] + soak->last_rates[2]) / 3.0;
+        if (first > 0 && last < first * (1.0 - threshold)) {
+            fprintf(stderr, "WARNING: %s throughput degraded %.0f%% over the run (%.0f -> %.0f ops/s); "
+                            "check for memory fragmentation or leaks\n",
+                    soak->name, 100.0 * (1.0 - last / first), first, last);
+        }
+    }
+    return soak->failures;
+}
+
+#define SOAK_TEST(seconds, test_code, message)                                                             \
+    do {                                                                                                   \
+        gs_soak_t _soak __attribute__((cleanup(gs_soak_restore_sigint)));                                  \
+        gs_soak_begin(&_soak, (seconds), message);                                                         \
+        do {                                                                                               \
+            for (int _b = 0; _b < _soak.batch; _b++) {                                                     \
+                if (!(test_code)) {                                                                        \
+                    _soak.batch_failures++;                                                                \
+                }                                                                                          \
+            }                                                                                              \
+        } while (gs_soak_tick(&_soak));                                                                    \
+        if (gs_soak_end(&_soak) > 0) {                                                                     \
+            fprintf(stderr, "SOAK TEST FAIL: %lld/%lld iterations failed\n", _soak.failures, _soak.iterations); \
+            GS_PRINT_SEED();                                                                               \
+            return 0;                                                                                      \
+        } else {                                                                                           \
+            printf("SOAK TEST PASS: All %lld iterations passed\n", _soak.iterations);                      \
+        }                                                                                                  \
+    } while(0)
+
+#define REPEAT_FOR(seconds, test_code)                                                                     \
+    do {                                                                                                   \
+        gs_soak_t _soak __attribute__((cleanup(gs_soak_restore_sigint)));                                  \
+        gs_soak_begin(&_soak, (seconds), "repeat");                                                        \
+        do {                                                                                               \
+            for (int _b = 0; _b < _soak.batch; _b++) {                                                     \
+                test_code;                                                                                 \
+            }                                                                                              \
+        } while (gs_soak_tick(&_soak));                                                                    \
+        gs_soak_end(&_soak);                                                                               \
+    } while(0)
+
+// Concurrent stress testing
+//
+// CONCURRENT_STRESS_TEST(threads, iterations, body, invariant, message) calls
+// `int body(int thread, int iteration)` `iterations` times on each of `threads` threads. All threads
+// start together at a spin barrier so they really overlap. STRESS_YIELD() marks a point in the code
+// under test where, during a concurrent stress test, the thread randomly calls sched_yield() or spins
+// for a moment to shake up interleavings; elsewhere it does nothing. Each thread counts its failures
+// in its own cache line, so no lock is shared. After all threads finish, the invariant expression is
+// checked and throughput is reported per thread.
+
+#define GS_STRESS_MAX_THREADS  256
+#define GS_STRESS_YIELD_ONE_IN 8
+
+#if defined(__x86_64__) || defined(__i386__)
+#define GS_CPU_RELAX() __builtin_ia32_pause()
+#else
+#define GS_CPU_RELAX() __asm__ __volatile__("" ::: "memory")
+#endif
+
+typedef int (*gs_stress_body_t)(int thread, int iteration);
+
+typedef struct
+{
+    pthread_t        handle;
+    int              thread;
+    int              iterations;
+    gs_stress_body_t body;
+    long             failures;
+    long             first_failure;     /// ? iteration of the first failure, -1 if none
+    double           seconds;
+} __attribute__((aligned(64))) gs_stress_slot_t;
+
+static gs_stress_slot_t gs_stress_slots[GS_STRESS_MAX_THREADS];
+static int              gs_stress_arrived = 0;
+static int              gs_stress_threads = 0;
+static __thread int     gs_stress_perturb = 0;
+
+static inline void gs_stress_yield(void) {
+    if (!gs_stress_perturb || gs_rand_below(GS_STRESS_YIELD_ONE_IN) != 0) {
+        return;
+    }
+    if (gs_rand_below(2)) {
+        sched_yield();
+    } else {
+        for (uint64_t spins = gs_rand_below(1024); spins > 0; spins--) {
+            GS_CPU_RELAX();
+        }
+    }
+}
+
+static inline void *gs_stress_thread(void *arg) {
+    gs_stress_slot_t *slot = arg;
+    gs_stress_perturb = 1;
+
+    __atomic_add_fetch(&gs_stress_arrived, 1, __ATOMIC_ACQ_REL);
+    /// ? The main thread lowers gs_stress_threads if some workers fail to start; reload it every spin
+    while (__atomic_load_n(&gs_stress_arrived, __ATOMIC_ACQUIRE) <
+           __atomic_load_n(&gs_stress_threads, __ATOMIC_ACQUIRE)) {
+        GS_CPU_RELAX();
+    }
+
+    int tracing = gs_trace_enabled();
+    if (tracing) {
+        char name[32];
+        snprintf(name, sizeof(name), "stress worker %d", slot->thread);
+        gs_trace_thread_name(name);
+    }
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < slot->iterations; i++) {
+        if (!slot->body(slot->thread, i)) {
+            if (slot->failures++ == 0) {
+                slot->first_failure = i;
+            }
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    slot->seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    if (tracing) {
+        gs_trace_record("stress worker", "worker", NULL,
+                        (uint64_t)start.tv_sec * 1000000000ULL + (uint64_t)start.tv_nsec,
+                        (uint64_t)end.tv_sec * 1000000000ULL + (uint64_t)end.tv_nsec);
+    }
+    gs_stress_perturb = 0;
+    return NULL;
+}
+
+/// ? Runs body on every thread and prints per-thread results; returns the total number of failed
+/// ? iterations, or -1 if the threads could not be started.
+static inline long gs_concurrent_stress_run(int threads, int iterations, gs_stress_body_t body) {
+    if (threads < 1 || threads > GS_STRESS_MAX_THREADS) {
+        fprintf(stderr, "ERROR: concurrent stress test needs 1..%d threads, got %d\n", GS_STRESS_MAX_THREADS, threads);
+        return -1;
+    }
+    gs_stress_arrived = 0;
+    gs_stress_threads = threads;
+    /// ? Settle lazily initialised state here, so workers only ever read it
+    gs_rand_seed();
+    gs_trace_enabled();
+
+    int started = 0;
+    for (; started < threads; started++) {
+        gs_stress_slot_t *slot = &gs_stress_slots[started];
+        memset(slot, 0, sizeof(*slot));
+        slot->thread        = started;
+        slot->iterations    = iterations;
+        slot->body          = body;
+        slot->first_failure = -1;
+        if (pthread_create(&slot->handle, NULL, gs_stress_thread, slot) != 0) {
+            break;
+        }
+    }
+    if (started < threads) {
+        /// ? Let the threads that did start through the barrier before giving up
+        __atomic_store_n(&gs_stress_threads, started, __ATOMIC_RELEASE);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(gs_stress_slots[i].handle, NULL);
+    }
+    if (started < threads) {
+        fprintf(stderr, "ERROR: could only start %d of %d stress threads\n", started, threads);
+        return -1;
+    }
+
+    long failures = 0;
+    for (int i = 0; i < threads; i++) {
+        gs_stress_slot_t *slot = &gs_stress_slots[i];
+        printf("  thread %-3d %d ops in %.3fs (%.0f ops/s), %ld failures",
+               i, iterations, slot->seconds, slot->seconds > 0 ? iterations / slot->seconds : 0.0, slot->failures);
+        if (slot->failures > 0) {
+            printf(", first at iteration %ld", slot->first_failure);
+        }
+        printf("\n");
+        failures += slot->failures;
+    }
+    return failures;
+}
+
+#define STRESS_YIELD() gs_stress_yield()
+
+#define CONCURRENT_STRESS_TEST(threads, iterations, body, invariant, message)                              \
+    do {                                                                                                   \
+        printf("CONCURRENT STRESS TEST: %s (%d threads x %d iterations)\n", message, threads, iterations); \
+        long _failures = gs_concurrent_stress_run((threads), (iterations), body);                          \
+        if (_failures < 0) {                                                                               \
+            return 0;                                                                                      \
+        } else if (_failures > 0) {                                                                        \
+            fprintf(stderr, "CONCURRENT STRESS TEST FAIL: %ld/%ld iterations failed\n",                    \
+                    _failures, (long)(threads) * (iterations));                                            \
+            GS_PRINT_SEED();                                                                               \
+            return 0;                                                                                      \
+        } else if (!(invariant)) {                                                                         \
+            fprintf(stderr, "CONCURRENT STRESS TEST FAIL: invariant '%s' does not hold\n", #invariant);    \
+            GS_PRINT_SEED();                                                                               \
+            return 0;                                                                                      \
+        } else {                                                                                           \
+            printf("CONCURRENT STRESS TEST PASS: All %ld iterations passed\n",                             \
+                   (long)(threads) * (iterations));                                                        \
+        }                                                                                                  \
+    } while(0)
+
+// Property-based testing
+//
+// A property is a function that draws its inputs from generators and returns non-zero when the
+// property holds:
+//
+//      int prop_sort_orders(gs_prop_t *p) {
+//          int values[64];
+//          size_t n = PROP_ARRAY_INT(p, "values", values, 64, -1000, 1000);
+//          my_sort(values, n);
+//          return is_sorted(values, n);
+//      }
+//
+//      PROPERTY_TEST(prop_sort_orders, 100000, "sorting orders any array");
+//
+// Every generator reads from one sequence of recorded choices, with 0 as the simplest choice. Later
+// cases get a larger size budget, so early cases are small. On failure the choice sequence is shrunk
+// by deleting runs of choices and lowering individual choices, replaying the property each time, and
+// the smallest failing input is printed with the seed. Generators for structs are ordinary functions
+// that call the generators below for each field; PROP_MORE builds arrays of anything.
+// No memory is allocated while generating or shrinking.
+
+#define GS_PROP_MAX_CHOICES  4096
+#define GS_PROP_MAX_SIZE     100
+#define GS_PROP_MAX_SHRINKS  20000
+
+typedef struct
+{
+    uint64_t        choices[GS_PROP_MAX_CHOICES];   /// ? choices made by the current run
+    size_t          count;
+    const uint64_t *replay;                         /// ? non-NULL while replaying a fixed sequence
+    size_t          replay_len;
+    int             size;                           /// ? size budget, 1..GS_PROP_MAX_SIZE
+    int             printing;                       /// ? print each generated value (counterexample)
+} gs_prop_t;
+
+static gs_prop_t gs_prop_ctx;
+static uint64_t  gs_prop_best[GS_PROP_MAX_CHOICES];
+static size_t    gs_prop_best_len;
+static uint64_t  gs_prop_candidate[GS_PROP_MAX_CHOICES];
+static int       gs_prop_shrinks;
+
+/// ? Records choice v and returns it; when replaying, returns the recorded choice clamped to max.
+static inline uint64_t gs_prop_choose(gs_prop_t *p, uint64_t v, uint64_t max) {
+    if (p->replay) {
+        v = p->count < p->replay_len ? p->replay[p->count] : 0;
+        if (v > max) v = max;
+    }
+    if (p->count < GS_PROP_MAX_CHOICES) {
+        p->choices[p->count++] = v;
+    }
+    return v;
+}
+
+/// ? Uniform choice in [0, max].
+static inline uint64_t gs_prop_draw(gs_prop_t *p, uint64_t max) {
+    uint64_t v = 0;
+    if (!p->replay) {
+        v = max == UINT64_MAX ? gs_rand_u64() : gs_rand_below(max + 1);
+    }
+    return gs_prop_choose(p, v, max);
+}
+
+/// ? Largest magnitude the size budget allows: 2^0 for the first cases up to 2^62 for the last.
+static inline uint64_t gs_prop_limit(gs_prop_t *p) {
+    return p->size >= GS_PROP_MAX_SIZE ? UINT64_MAX : (1ULL << (p->size * 62 / GS_PROP_MAX_SIZE));
+}
+
+static inline long long gs_prop_int(gs_prop_t *p, const char *name, long long min, long long max) {
+    uint64_t limit = gs_prop_limit(p);
+    long long value;
+    if (min <= 0 && max >= 0) {
+        int negative = (min < 0 && max > 0) ? (int)gs_prop_draw(p, 1) : (min < 0);
+        uint64_t bound = negative ? (uint64_t)0 - (uint64_t)min : (uint64_t)max;
+        uint64_t magnitude = gs_prop_draw(p, bound < limit ? bound : limit);
+        value = negative ? (long long)((uint64_t)0 - magnitude) : (long long)magnitude;
+    } else {
+        uint64_t span = (uint64_t)max - (uint64_t)min;
+        uint64_t offset = gs_prop_draw(p, span < limit ? span : limit);
+        value = min > 0 ? (long long)((uint64_t)min + offset) : (long long)((uint64_t)max - offset);
+    }
+    if (p->printing && name) {
+        fprintf(stderr, "    %s = %lld\n", name, value);
+    }
+    return value;
+}
+
+static inline double gs_prop_double(gs_prop_t *p, const char *name, double min, double max) {
+    double scale = (double)p->size / GS_PROP_MAX_SIZE;
+    double value;
+    if (min <= 0.0 && max >= 0.0) {
+        int negative = (min < 0.0 && max > 0.0) ? (int)gs_prop_draw(p, 1) : (min < 0.0);
+        double fraction = (double)gs_prop_draw(p, (1ULL << 53) - 1) / 9007199254740992.0;
+        value = negative ? fraction * min * scale : fraction * max * scale;
+    } else {
+        double fraction = (double)gs_prop_draw(p, (1ULL << 53) - 1) / 9007199254740992.0;
+        value = min > 0.0 ? min + fraction * (max - min) * scale : max - fraction * (max - min) * scale;
+    }
+    if (p->printing && name) {
+        fprintf(stderr, "    %s = %.17g\n", name, value);
+    }
+    return value;
+}
+
+static inline int gs_prop_bool(gs_prop_t *p, const char *name) {
+    int value = (int)gs_prop_draw(p, 1);
+    if (p->printing && name) {
+        fprintf(stderr, "    %s = %s\n", name, value ? "true" : "false");
+    }
+    return value;
+}
+
+/// ? Decides whether a collection that already holds `count` elements gets another one.
+/// ? Each element is preceded by a 1 choice and the end by a 0, so deleting a run of choices
+/// ? while shrinking removes whole elements.
+static inline int gs_prop_more(gs_prop_t *p, size_t count, size_t cap) {
+    if (count >= cap) {
+        return 0;
+    }
+    uint64_t v = 0;
+    if (!p->replay) {
+        double average = (double)(cap < (size_t)p->size ? cap : (size_t)p->size) / 2.0;
+        v = gs_rand_double() < average / (average + 1.0);
+    }
+    return (int)gs_prop_choose(p, v, 1);
+}
+
+static inline size_t gs_prop_array_int(gs_prop_t *p, const char *name, int *out, size_t cap, int min, int max) {
+    size_t n = 0;
+    while (gs_prop_more(p, n, cap)) {
+        out[n++] = (int)gs_prop_int(p, NULL, min, max);
+    }
+    if (p->printing && name) {
+        fprintf(stderr, "    %s = [", name);
+        for (size_t i = 0; i < n; i++) {
+            fprintf(stderr, "%s%d", i ? ", " : "", out[i]);
+        }
+        fprintf(stderr, "] (%zu elements)\n", n);
+    }
+    return n;
+}
+
+/// ? Fills buf with a NUL-terminated printable string of at most cap - 1 characters; shrinks toward "a".
+static inline size_t gs_prop_string(gs_prop_t *p, const char *name, char *buf, size_t cap) {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789"
+                                   " !\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~";
+    size_t n = 0;
+    while (cap > 0 && gs_prop_more(p, n, cap - 1)) {
+        buf[n++] = alphabet[gs_prop_draw(p, sizeof(alphabet) - 2)];
+    }
+    if (cap > 0) {
+        buf[n] = '\0';
+    }
+    if (p->printing && name) {
+        fprintf(stderr, "    %s = \"", name);
+        for (size_t i = 0; i < n; i++) {
+            if (buf[i] == '"' || buf[i] == '\\') fputc('\\', stderr);
+            fputc(buf[i], stderr);
+        }
+        fprintf(stderr, "\" (%zu chars)\n", n);
+    }
+    return n;
+}
+
+/// ? Shortlex order on choice sequences: fewer choices first, then smaller choices.
+static inline int gs_prop_simpler(const uint64_t *a, size_t a_len, const uint64_t *b, size_t b_len) {
+    if (a_len != b_len) {
+        return a_len < b_len;
+    }
+    for (size_t i = 0; i < a_len; i++) {
+        if (a[i] != b[i]) return a[i] < b[i];
+    }
+    return 0;
+}
+
+/// ? Replays gs_prop_candidate; keeps it as the new best if the property still fails on a simpler input.
+static inline int gs_prop_try(int (*property)(gs_prop_t *), size_t len) {
+    gs_prop_t *p = &gs_prop_ctx;
+    p->replay     = gs_prop_candidate;
+    p->replay_len = len;
+    p->count      = 0;
+    p->size       = GS_PROP_MAX_SIZE;
+    p->printing   = 0;
+    gs_prop_shrinks++;
+    if (property(p) || !gs_prop_simpler(p->choices, p->count, gs_prop_best, gs_prop_best_len)) {
+        return 0;
+    }
+    memcpy(gs_prop_best, p->choices, p->count * sizeof(uint64_t));
+    gs_prop_best_len = p->count;
+    return 1;
+}
+
+static inline void gs_prop_shrink(int (*property)(gs_prop_t *)) {
+    int improved = 1;
+    while (improved && gs_prop_shrinks < GS_PROP_MAX_SHRINKS) {
+        improved = 0;
+
+        /// ? Delete runs of choices, longest runs first
+        for (size_t run = 8; run >= 1; run--) {
+            for (size_t i = 0; i + run <= gs_prop_best_len && gs_prop_shrinks < GS_PROP_MAX_SHRINKS; ) {
+                size_t len = gs_prop_best_len - run;
+                memcpy(gs_prop_candidate, gs_prop_best, i * sizeof(uint64_t));
+                memcpy(gs_prop_candidate + i, gs_prop_best + i + run, (len - i) * sizeof(uint64_t));
+                if (gs_prop_try(property, len)) {
+                    improved = 1;
+                } else {
+                    i++;
+                }
+            }
+        }
+
+        /// ? Lower each choice: straight to zero if possible, else binary search toward it
+        for (size_t i = 0; i < gs_prop_best_len && gs_prop_shrinks < GS_PROP_MAX_SHRINKS; i++) {
+            uint64_t lo = 0;
+            while (i < gs_prop_best_len && lo < gs_prop_best[i] && gs_prop_shrinks < GS_PROP_MAX_SHRINKS) {
+                uint64_t mid = lo + (gs_prop_best[i] - lo) / 2;
+                memcpy(gs_prop_candidate, gs_prop_best, gs_prop_best_len * sizeof(uint64_t));
+                gs_prop_candidate[i] = lo;
+                if (gs_prop_try(property, gs_prop_best_len)) {
+                    improved = 1;
+                    continue;
+                }
+                gs_prop_candidate[i] = mid;
+                if (gs_prop_try(property, gs_prop_best_len)) {
+                    improved = 1;
+                } else {
+                    lo = mid + 1;
+                }
+            }
+        }
+    }
+}
+
+/// ? Runs up to `iterations` cases; returns 0 if all pass, else the 1-based number of the failing case
+/// ? after shrinking it into gs_prop_best.
+static inline int gs_property_run(int (*property)(gs_prop_t *), int iterations) {
+    gs_prop_t *p = &gs_prop_ctx;
+    for (int i = 0; i < iterations; i++) {
+        p->replay   = NULL;
+        p->count    = 0;
+        p->printing = 0;
+        p->size     = 1 + (int)((long long)i * (GS_PROP_MAX_SIZE - 1) / (iterations > 1 ? iterations - 1 : 1));
+        if (!property(p)) {
+            memcpy(gs_prop_best, p->choices, p->count * sizeof(uint64_t));
+            gs_prop_best_len = p->count;
+            gs_prop_shrinks  = 0;
+            gs_prop_shrink(property);
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+/// ? Replays the shrunk counterexample with printing on.
+static inline void gs_property_print_counterexample(int (*property)(gs_prop_t *)) {
+    gs_prop_t *p = &gs_prop_ctx;
+    memcpy(gs_prop_candidate, gs_prop_best, gs_prop_best_len * sizeof(uint64_t));
+    p->replay     = gs_prop_candidate;
+    p->replay_len = gs_prop_best_len;
+    p->count      = 0;
+    p->size       = GS_PROP_MAX_SIZE;
+    p->printing   = 1;
+    property(p);
+    p->printing   = 0;
+}
+
+#define PROP_INT(p, name, min, max)                         gs_prop_int((p), (name), (min), (max))
+#define PROP_DOUBLE(p, name, min, max)                      gs_prop_double((p), (name), (min), (max))
+#define PROP_BOOL(p, name)                                  gs_prop_bool((p), (name))
+#define PROP_MORE(p, count, cap)                            gs_prop_more((p), (count), (cap))
+#define PROP_ARRAY_INT(p, name, buffer, cap, min, max)      gs_prop_array_int((p), (name), (buffer), (cap), (min), (max))
+#define PROP_STRING(p, name, buffer, cap)                   gs_prop_string((p), (name), (buffer), (cap))
+
+#define PROPERTY_TEST(property, iterations, message)                                                       \
+    do {                                                                                                   \
+        printf("PROPERTY TEST: %s (%d cases)\n", message, iterations);                                     \
+        int _failing_case = gs_property_run(property, (iterations));                                       \
+        if (_failing_case > 0) {                                                                           \
+            fprintf(stderr, "PROPERTY TEST FAIL: %s - falsified by case %d, shrunk in %d steps to:\n",     \
+                    message, _failing_case, gs_prop_shrinks);                                              \
+            gs_property_print_counterexample(property);                                                    \
+            GS_PRINT_SEED();                                                                               \
+            return 0;                                                                                      \
+        } else {                                                                                           \
+            printf("PROPERTY TEST PASS: All %d cases passed\n", iterations);                               \
+        }                                                                                                  \
+    } while(0)
+
+// Coverage-guided fuzzing
+//
+// FUZZ_TEST(name, data, size) defines a test function `name` whose body receives one input and
+// returns 1, just like a test function:
+//
+//      FUZZ_TEST(fuzz_parse_header, data, size) {
+//          header_t h;
+//          parse_header(data, size, &h);
+//          return 1;
+//      }
+//
+//      RUN_TEST(fuzz_parse_header);
+//
+// In a normal run, RUN_TEST replays every file in the target's corpus directory
+// ($GS_FUZZ_CORPUS/<name>, default fuzz_corpus/<name>) as a regression test. Each input runs in a
+// forked child, so a saved crash fails the test and names the file instead of killing the run.
+//
+// With GS_FUZZ=<name> (or GS_FUZZ=all), RUN_TEST fuzzes instead for GS_FUZZ_SECONDS (default 60).
+// A worker process mutates corpus inputs and keeps the ones that reach new coverage. Coverage comes
+// from the -fsanitize-coverage=trace-pc-guard (clang) or trace-pc (gcc) callbacks defined below, so
+// no fuzzing library is needed. The callbacks and their 64 KiB map are only compiled in when
+// GLITCHSNITCH_FUZZ is defined, so other binaries keep a sanitizer runtime's own hooks; without it
+// replay still works and GS_FUZZ fails the test. Inputs up to GS_FUZZ_MAX_LEN bytes (default 4096) are generated.
+// A crash, a non-zero exit or a body returning 0 ends the worker. The test process then minimizes
+// the input and saves it as crash-<hash> in the corpus, where later runs replay it. An input that
+// runs longer than GS_FUZZ_TIMEOUT seconds (default 10) gets the worker killed and is saved as
+// timeout-<hash> without minimizing; replayed inputs are held to the same limit.
+
+#define GS_FUZZ_MAP_SIZE     (1 << 16)
+#define GS_FUZZ_MAX_CORPUS   4096
+#define GS_FUZZ_TIMEOUT      10
+
+#if defined(__has_attribute)
+#if __has_attribute(no_sanitize_coverage)
+#define GS_NO_COVERAGE __attribute__((no_sanitize_coverage))
+#elif __has_attribute(no_sanitize)
+#define GS_NO_COVERAGE __attribute__((no_sanitize("coverage")))
+#endif
+#endif
+#ifndef GS_NO_COVERAGE
+#define GS_NO_COVERAGE
+#endif
+
+#ifdef GLITCHSNITCH_FUZZ
+
+/// ? Shared by every file that includes this header, hence weak rather than static
+__attribute__((weak)) unsigned char gs_fuzz_map[GS_FUZZ_MAP_SIZE];
+__attribute__((weak)) uint32_t      gs_fuzz_guards;
+__attribute__((weak)) uintptr_t     gs_fuzz_prev_pc;
+__attribute__((weak)) volatile int  gs_fuzz_recording;     /// ? only the body's own coverage counts
+
+__attribute__((weak)) GS_NO_COVERAGE void __sanitizer_cov_trace_pc_guard_init(uint32_t *start, uint32_t *stop) {
+    if (start == stop || *start) {
+        return;
+    }
+    for (uint32_t *guard = start; guard < stop; guard++) {
+        *guard = ++gs_fuzz_guards;
+    }
+}
+
+__attribute__((weak)) GS_NO_COVERAGE void __sanitizer_cov_trace_pc_guard(uint32_t *guard) {
+    if (gs_fuzz_recording) {
+        gs_fuzz_map[*guard % GS_FUZZ_MAP_SIZE]++;
+    }
+}
+
+/// ? gcc only offers trace-pc; hash (previous block, this block) pairs as AFL does for edges
+__attribute__((weak)) GS_NO_COVERAGE void __sanitizer_cov_trace_pc(void) {
+    if (!gs_fuzz_recording) {
+        return;
+    }
+    uintptr_t pc = (uintptr_t)__builtin_return_address(0);
+    gs_fuzz_map[(pc ^ gs_fuzz_prev_pc) % GS_FUZZ_MAP_SIZE]++;
+    gs_fuzz_prev_pc = pc >> 1;
+}
+
+#endif /* GLITCHSNITCH_FUZZ */
+
+typedef struct
+{
+    unsigned long execs;
+    unsigned long corpus;
+    unsigned long features;
+    size_t        input_size;   /// ? input being executed, read back by the parent after a crash
+    uint8_t       input[];
+} gs_fuzz_shared_t;
+
+typedef struct
+{
+    uint8_t *data;
+    size_t   size;
+} gs_fuzz_input_t;
+
+static inline uint64_t gs_fuzz_hash(const uint8_t *data, size_t size) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static inline void gs_fuzz_corpus_dir(const char *name, char *path, size_t len) {
+    const char *root = getenv("GS_FUZZ_CORPUS");
+    snprintf(path, len, "%s/%s", root ? root : "fuzz_corpus", name);
+}
+
+/// ? Writes data to dir/<prefix><hash>; existing files are left alone.
+static inline void gs_fuzz_save(const char *dir, const char *prefix, const uint8_t *data, size_t size,
+                                char *path, size_t path_len) {
+    char parent[512];
+    snprintf(parent, sizeof(parent), "%s", dir);
+    char *slash = strrchr(parent, '/');
+    if (slash) {
+        *slash = '\0';
+        mkdir(parent, 0755);
+    }
+    mkdir(dir, 0755);
+
+    snprintf(path, path_len, "%s/%s%016llx", dir, prefix, (unsigned long long)gs_fuzz_hash(data, size));
+    int fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd >= 0) {
+        if (size > 0 && write(fd, data, size) != (ssize_t)size) {
+            fprintf(stderr, "WARNING: short write to '%s'\n", path);
+        }
+        close(fd);
+    }
+}
+
+/// ? Calls fn(path, data, size, arg) for every file in dir; returns the number of files or -1 without a dir.
+static inline long gs_fuzz_each_file(const char *dir, size_t max_len,
+                                     int (*fn)(const char *, const uint8_t *, size_t, void *), void *arg) {
+    DIR *d = opendir(dir);
+    if (d == NULL) {
+        return -1;
+    }
+    uint8_t *buffer = malloc(max_len ? max_len : 1);
+    long files = 0;
+    struct dirent *entry;
+    while (buffer && (entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            continue;
+        }
+        ssize_t size = read(fd, buffer, max_len);
+        close(fd);
+        if (size < 0) {
+            continue;
+        }
+        files++;
+        if (!fn(path, buffer, (size_t)size, arg)) {
+            break;
+        }
+    }
+    free(buffer);
+    closedir(d);
+    return files;
+}
+
+/// ? Applies one to four random mutations in place; returns the new size.
+static inline size_t gs_fuzz_mutate(uint8_t *data, size_t size, size_t max_len,
+                                    const gs_fuzz_input_t *corpus, size_t corpus_count) {
+    static const uint8_t interesting[] = {0x00, 0x01, 0x7f, 0x80, 0xff, 0x10, 0x20, 0x40, 0x64, 0xfe};
+    int rounds = 1 + (int)gs_rand_below(4);
+    for (int r = 0; r < rounds; r++) {
+        size_t pos = size ? (size_t)gs_rand_below(size) : 0;
+        switch (gs_rand_below(8)) {
+        case 0:     /// ? flip a bit
+            if (size) data[pos] ^= (uint8_t)(1u << gs_rand_below(8));
+            break;
+        case 1:     /// ? random byte
+            if (size) data[pos] = (uint8_t)gs_rand_u64();
+            break;
+        case 2:     /// ? interesting byte
+            if (size) data[pos] = interesting[gs_rand_below(sizeof(interesting))];
+            break;
+        case 3:     /// ? small add/subtract
+            if (size) data[pos] = (uint8_t)(data[pos] + (int)gs_rand_below(33) - 16);
+            break;
+        case 4:     /// ? insert random bytes
+            if (size < max_len) {
+                size_t count = 1 + (size_t)gs_rand_below(max_len - size < 8 ? max_len - size : 8);
+                memmove(data + pos + count, data + pos, size - pos);
+                gs_rand_fill(data + pos, count);
+                size += count;
+            }
+            break;
+        case 5:     /// ? delete a range
+            if (size > 1) {
+                size_t count = 1 + (size_t)gs_rand_below(size - pos < 16 ? size - pos : 16);
+                memmove(data + pos, data + pos + count, size - pos - count);
+                size -= count;
+            }
+            break;
+        case 6:     /// ? copy a range over another spot
+            if (size > 1) {
+                size_t from  = (size_t)gs_rand_below(size);
+                size_t count = 1 + (size_t)gs_rand_below(size - (from > pos ? from : pos));
+                memmove(data + pos, data + from, count);
+            }
+            break;
+        default:    /// ? splice in the tail of another corpus input
+            if (corpus_count) {
+                const gs_fuzz_input_t *other = &corpus[gs_rand_below(corpus_count)];
+                if (other->size) {
+                    size_t from  = (size_t)gs_rand_below(other->size);
+                    size_t count = other->size - from;
+                    if (pos + count > max_len) count = max_len - pos;
+                    memcpy(data + pos, other->data + from, count);
+                    if (pos + count > size) size = pos + count;
+                }
+            }
+            break;
+        }
+    }
+    return size;
+}
+
+typedef int (*gs_fuzz_body_t)(const uint8_t *data, size_t size);
+
+typedef struct
+{
+    gs_fuzz_body_t    body;
+    gs_fuzz_input_t  *corpus;
+    size_t            count;
+    size_t            max_len;
+    uint8_t          *virgin;
+    long              failures;
+} gs_fuzz_state_t;
+
+static inline int gs_fuzz_load_one(const char *path, const uint8_t *data, size_t size, void *arg) {
+    gs_fuzz_state_t *state = arg;
+    (void)path;
+    if (state->count == GS_FUZZ_MAX_CORPUS) {
+        return 0;
+    }
+    gs_fuzz_input_t *entry = &state->corpus[state->count];
+    entry->data = malloc(state->max_len);
+    if (entry->data == NULL) {
+        return 0;
+    }
+    memcpy(entry->data, data, size);
+    entry->size = size;
+    state->count++;
+    return 1;
+}
+
+/// ? Seconds one input may run before it counts as a hang.
+static inline unsigned gs_fuzz_timeout(void) {
+    const char *env = getenv("GS_FUZZ_TIMEOUT");
+    return env && atoi(env) > 0 ? (unsigned)atoi(env) : GS_FUZZ_TIMEOUT;
+}
+
+/// ? Whether a child's wait status means the per-input alarm ended it.
+static inline int gs_fuzz_timed_out(int status) {
+    return status != -1 && WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM;
+}
+
+/// ? Runs body on one input in a silenced child; returns its wait status, or -1 if fork() failed.
+/// ? The child is killed by SIGALRM if the input runs longer than gs_fuzz_timeout() seconds.
+static inline int gs_fuzz_run_child(gs_fuzz_body_t body, const uint8_t *data, size_t size) {
+    unsigned timeout = gs_fuzz_timeout();
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid == 0) {
+        gs_silence_output();
+        signal(SIGALRM, SIG_DFL);
+        alarm(timeout);
+        _exit(body(data, size) ? 0 : 1);
+    }
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) < 0) {
+        return -1;
+    }
+    return status;
+}
+
+static inline int gs_fuzz_replay_one(const char *path, const uint8_t *data, size_t size, void *arg) {
+    gs_fuzz_state_t *state = arg;
+    int status = gs_fuzz_run_child(state->body, data, size);
+    if (status == -1) {
+        fprintf(stderr, "  %s: could not fork to replay it\n", path);
+        state->failures++;
+    } else if (WIFEXITED(status) && WEXITSTATUS(status) == 1) {
+        fprintf(stderr, "  %s: body returned 0\n", path);
+        state->failures++;
+    } else if (gs_fuzz_timed_out(status)) {
+        fprintf(stderr, "  %s: timed out after %u s\n", path, gs_fuzz_timeout());
+        state->failures++;
+    } else if (status != 0) {
+        fprintf(stderr, "  %s: %s\n", path, gs_crash_describe(status));
+        state->failures++;
+    }
+    return 1;
+}
+
+/// ? Runs body on one input in a silenced child; returns 1 if it crashed, exited non-zero or returned 0.
+static inline int gs_fuzz_fails(gs_fuzz_body_t body, const uint8_t *data, size_t size) {
+    int status = gs_fuzz_run_child(body, data, size);
+    /// ? A candidate that hangs is a different bug; keep shrinking toward the original failure
+    return status != -1 && status != 0 && !gs_fuzz_timed_out(status);
+}
+
+/// ? Removes ever smaller chunks from a failing input while it keeps failing; returns the new size.
+static inline size_t gs_fuzz_minimize(gs_fuzz_body_t body, uint8_t *data, size_t size) {
+    uint8_t *candidate = malloc(size ? size : 1);
+    int attempts = 0;
+    for (size_t chunk = size / 2; candidate && chunk >= 1 && attempts < 2000; chunk /= 2) {
+        for (size_t off = 0; off + chunk <= size && attempts < 2000; attempts++) {
+            memcpy(candidate, data, off);
+            memcpy(candidate + off, data + off + chunk, size - off - chunk);
+            if (gs_fuzz_fails(body, candidate, size - chunk)) {
+                size -= chunk;
+                memcpy(data, candidate, size);
+            } else {
+                off += chunk;
+            }
+        }
+    }
+    free(candidate);
+    return size;
+}
+
+#ifdef GLITCHSNITCH_FUZZ
+
+/// ? AFL-style hit-count classes: 1, 2, 3, 4-7, 8-15, 16-31, 32-127, 128+
+static inline GS_NO_COVERAGE uint8_t gs_fuzz_bucket(uint8_t hits) {
+    if (hits <= 3) return hits == 3 ? 4 : hits;
+    if (hits <= 7)   return 8;
+    if (hits <= 15)  return 16;
+    if (hits <= 31)  return 32;
+    if (hits <= 127) return 64;
+    return 128;
+}
+
+/// ? Folds the last run's coverage into virgin; returns the number of new (edge, class) pairs.
+static inline GS_NO_COVERAGE unsigned long gs_fuzz_new_features(uint8_t *virgin) {
+    unsigned long found = 0;
+    const uint64_t *words = (const uint64_t *)gs_fuzz_map;
+    for (size_t w = 0; w < GS_FUZZ_MAP_SIZE / 8; w++) {
+        if (words[w] == 0) {
+            continue;
+        }
+        for (size_t i = w * 8; i < w * 8 + 8; i++) {
+            if (gs_fuzz_map[i]) {
+                uint8_t bucket = gs_fuzz_bucket(gs_fuzz_map[i]);
+                if (!(virgin[i] & bucket)) {
+                    virgin[i] |= bucket;
+                    found++;
+                }
+            }
+        }
+    }
+    return found;
+}
+
+/// ? Runs body on one input with a fresh coverage map; returns what body returned.
+static inline GS_NO_COVERAGE int gs_fuzz_execute(gs_fuzz_body_t body, const uint8_t *data, size_t size) {
+    memset(gs_fuzz_map, 0, sizeof(gs_fuzz_map));
+    gs_fuzz_prev_pc   = 0;
+    gs_fuzz_recording = 1;
+    /// ? The coverage callbacks are inserted after optimization, so the compiler cannot see that
+    /// ? body touches the map; the barriers keep the clear and the later scan around the call.
+    __asm__ __volatile__("" ::: "memory");
+    int result = body(data, size);
+    __asm__ __volatile__("" ::: "memory");
+    gs_fuzz_recording = 0;
+    return result;
+}
+
+/// ? Runs in the forked worker until the deadline; leaves via _exit().
+static inline void gs_fuzz_worker(gs_fuzz_body_t body, const char *dir, size_t max_len, double seconds,
+                                  gs_fuzz_shared_t *shared) {
+    int devnull = open("/dev/null", O_WRONLY);
+    if (devnull >= 0) {
+        dup2(devnull, STDOUT_FILENO);
+        close(devnull);
+    }
+
+    gs_fuzz_state_t state;
+    memset(&state, 0, sizeof(state));
+    state.body    = body;
+    state.max_len = max_len;
+    state.corpus  = calloc(GS_FUZZ_MAX_CORPUS, sizeof(gs_fuzz_input_t));
+    state.virgin  = calloc(GS_FUZZ_MAP_SIZE, 1);
+    uint8_t *input = malloc(max_len);
+    if (state.corpus == NULL || state.virgin == NULL || input == NULL) {
+        _exit(0);
+    }
+
+    gs_fuzz_each_file(dir, max_len, gs_fuzz_load_one, &state);
+    if (state.count == 0) {
+        gs_fuzz_load_one(NULL, (const uint8_t *)"", 0, &state);
+    }
+
+    /// ? Replay the corpus first so its coverage is not reported as new
+    for (size_t i = 0; i < state.count; i++) {
+        memcpy(shared->input, state.corpus[i].data, state.corpus[i].size);
+        shared->input_size = state.corpus[i].size;
+        if (!gs_fuzz_execute(body, state.corpus[i].data, state.corpus[i].size)) {
+            _exit(1);
+        }
+        shared->features += gs_fuzz_new_features(state.virgin);
+        shared->execs++;
+    }
+    if (shared->features == 0) {
+        fprintf(stderr, "WARNING: no coverage feedback; build with -fsanitize-coverage=trace-pc-guard "
+                        "(clang) or -fsanitize-coverage=trace-pc (gcc)\n");
+    }
+
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    double next_report = 5.0;
+    for (;;) {
+        const gs_fuzz_input_t *parent = &state.corpus[gs_rand_below(state.count)];
+        memcpy(input, parent->data, parent->size);
+        size_t size = gs_fuzz_mutate(input, parent->size, max_len, state.corpus, state.count);
+
+        memcpy(shared->input, input, size);
+        shared->input_size = size;
+        if (!gs_fuzz_execute(body, input, size)) {
+            _exit(1);
+        }
+        shared->execs++;
+
+        unsigned long found = gs_fuzz_new_features(state.virgin);
+        if (found) {
+            char path[1024];
+            shared->features += found;
+            gs_fuzz_save(dir, "", input, size, path, sizeof(path));
+            gs_fuzz_load_one(NULL, input, size, &state);
+            shared->corpus = state.count;
+        }
+
+        if ((shared->execs & 255) == 0) {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            double elapsed = (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+            if (elapsed >= seconds) {
+                break;
+            }
+            if (elapsed >= next_report) {
+                fprintf(stderr, "FUZZ: #%lu cov: %lu corp: %lu exec/s: %.0f\n",
+                        shared->execs, shared->features, (unsigned long)state.count, shared->execs / elapsed);
+                next_report += 5.0;
+            }
+        }
+    }
+    shared->corpus = state.count;
+    _exit(0);
+}
+
+/// ? Fuzzes body for GS_FUZZ_SECONDS in a forked worker; returns 1 if no failing input was found.
+static inline int gs_fuzz_run(const char *name, gs_fuzz_body_t body, const char *dir, size_t max_len) {
+    const char *seconds_env = getenv("GS_FUZZ_SECONDS");
+    double seconds = seconds_env ? atof(seconds_env) : 60.0;
+    size_t shared_size = sizeof(gs_fuzz_shared_t) + max_len;
+    gs_fuzz_shared_t *shared = mmap(NULL, shared_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        fprintf(stderr, "FAIL: %s - could not map fuzzing state\n", name);
+        return 0;
+    }
+
+    printf("FUZZ: %s for %.0f seconds, corpus %s\n", name, seconds, dir);
+    fflush(stdout);
+    fflush(stderr);
+    uint64_t worker_seed = gs_rand_u64();
+    pid_t worker = fork();
+    if (worker == 0) {
+        RANDOM_SEED(worker_seed);
+        gs_fuzz_worker(body, dir, max_len, seconds, shared);
+    }
+    if (worker < 0) {
+        munmap(shared, shared_size);
+        fprintf(stderr, "FAIL: fork() failed for fuzz test\n");
+        return 0;
+    }
+
+    /// ? Poll instead of blocking in waitpid(), so a worker stuck on one input can be killed
+    unsigned timeout = gs_fuzz_timeout();
+    unsigned long last_execs = __atomic_load_n(&shared->execs, __ATOMIC_RELAXED);
+    struct timespec last_progress, now, pause = {0, 10 * 1000000L};
+    clock_gettime(CLOCK_MONOTONIC, &last_progress);
+    int status = 0, timed_out = 0;
+    for (;;) {
+        pid_t done = waitpid(worker, &status, WNOHANG);
+        if (done == worker || (done < 0 && errno != EINTR)) {
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        unsigned long execs = __atomic_load_n(&shared->execs, __ATOMIC_RELAXED);
+        if (execs != last_execs) {
+            last_execs    = execs;
+            last_progress = now;
+        } else if ((double)(now.tv_sec - last_progress.tv_sec) +
+                   (double)(now.tv_nsec - last_progress.tv_nsec) / 1e9 > (double)timeout) {
+            kill(worker, SIGKILL);
+            waitpid(worker, &status, 0);
+            timed_out = 1;
+            break;
+        }
+        nanosleep(&pause, NULL);
+    }
+
+    int passed = !timed_out && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    if (passed) {
+        printf("PASS: %s - %lu execs, %lu features, %lu corpus inputs\n",
+               name, shared->execs, shared->features, shared->corpus);
+    } else if (timed_out) {
+        char path[1024];
+        gs_fuzz_save(dir, "timeout-", shared->input, shared->input_size, path, sizeof(path));
+        fprintf(stderr, "FAIL: %s - input ran longer than %u s after %lu execs; saved %zu bytes: %s\n",
+                name, timeout, shared->execs, shared->input_size, path);
+    } else {
+        size_t size = gs_fuzz_minimize(body, shared->input, shared->input_size);
+        char path[1024];
+        gs_fuzz_save(dir, "crash-", shared->input, size, path, sizeof(path));
+        fprintf(stderr, "FAIL: %s - input failed after %lu execs (%s); minimized to %zu bytes: %s\n",
+                name, shared->execs, gs_crash_describe(status), size, path);
+    }
+    munmap(shared, shared_size);
+    return passed;
+}
+
+#endif /* GLITCHSNITCH_FUZZ */
+
+static inline int gs_fuzz_test(const char *name, gs_fuzz_body_t body) {
+    char dir[512];
+    gs_fuzz_corpus_dir(name, dir, sizeof(dir));
+    const char *max_len_env = getenv("GS_FUZZ_MAX_LEN");
+    size_t max_len = max_len_env ? (size_t)strtoul(max_len_env, NULL, 0) : 4096;
+
+    const char *target = getenv("GS_FUZZ");
+    if (target == NULL || (strcmp(target, name) != 0 && strcmp(target, "all") != 0)) {
+        /// ? Regression mode: every saved input must pass
+        gs_fuzz_state_t state;
+        memset(&state, 0, sizeof(state));
+        state.body = body;
+        long files = gs_fuzz_each_file(dir, max_len, gs_fuzz_replay_one, &state);
+        if (files < 0) {
+            printf("FUZZ REPLAY: %s has no corpus at %s\n", name, dir);
+        } else if (state.failures > 0) {
+            fprintf(stderr, "FAIL: %s - %ld of %ld corpus inputs failed\n", name, state.failures, files);
+            return 0;
+        } else {
+            printf("PASS: %s replayed %ld corpus inputs from %s\n", name, files, dir);
+        }
+        return 1;
+    }
+
+#ifdef GLITCHSNITCH_FUZZ
+    return gs_fuzz_run(name, body, dir, max_len);
+#else
+    fprintf(stderr, "FAIL: %s - fuzzing needs a build with -DGLITCHSNITCH_FUZZ and -fsanitize-coverage\n", name);
+    return 0;
+#endif
+}
+
+#define FUZZ_TEST(name, data, size)                                                                        \
+    static int name##_fuzz_body(const uint8_t *data, size_t size);                                        \
+    static int name(void) {                                                                                \
+        return gs_fuzz_test(#name, name##_fuzz_body);                                                      \
+    }                                                                                                      \
+    static int name##_fuzz_body(const uint8_t *data, size_t size)
+
+// Enhanced debugging
+//
+// TRACE_FUNCTION() and TRACE_SCOPE(name) declare a variable whose cleanup attribute ends the span
+// when it goes out of scope, on every return path. With TRACE=1 they also print entry and exit with
+// the time spent; with span recording on (see Trace spans) they add the span to the timeline.
+//
+// Being declarations, they cannot be the body of an unbraced if/else or follow a label directly:
+// write `if (x) { TRACE_FUNCTION(); ... }` or `label: ;`. TRACE_ENTER() is the old statement form;
+// it only prints the TRACE=1 entry line and records no span.
+
+typedef struct
+{
+    const char *name;
+    const char *category;
+    const char *file;
+    int         line;
+    int         print;     /// ? TRACE=1: print Entering/Leaving
+    int         record;    /// ? span recording is on
+    uint64_t    start_ns;
+} gs_trace_scope_t;
+
+static int gs_trace_print_state = 0;       /// ? 0 undecided, 1 TRACE set, -1 not set
+
+static inline GS_NO_INSTRUMENT gs_trace_scope_t gs_trace_scope_begin(const char *name, const char *category,
+                                                                       const char *file, int line) {
+    gs_trace_scope_t scope;
+    if (__builtin_expect(gs_trace_print_state == 0, 0)) {
+        gs_trace_print_state = getenv("TRACE") ? 1 : -1;
+    }
+    scope.name     = name;
+    scope.category = category;
+    scope.file     = file;
+    scope.line     = line;
+    scope.print    = gs_trace_print_state == 1;
+    scope.record   = gs_trace_enabled();
+    scope.start_ns = scope.print || scope.record ? gs_trace_now() : 0;
+    if (scope.print) {
+        fprintf(stderr, "TRACE: Entering %s (%s:%d)\n", name, file, line);
+    }
+    return scope;
+}
+
+static inline GS_NO_INSTRUMENT void gs_trace_scope_end(gs_trace_scope_t *scope) {
+    if (!scope->print && !scope->record) {
+        return;
+    }
+    uint64_t end_ns = gs_trace_now();
+    if (scope->record) {
+        gs_trace_record(scope->name, scope->category, NULL, scope->start_ns, end_ns);
+    }
+    if (scope->print) {
+        fprintf(stderr, "TRACE: Leaving %s after %.3f ms\n", scope->name, (end_ns - scope->start_ns) / 1e6);
+    }
+}
+
+#define GS_TRACE_CONCAT_(a, b) a##b
+#define GS_TRACE_CONCAT(a, b)  GS_TRACE_CONCAT_(a, b)
+
+#define GS_TRACE_SCOPE(name, category)                                                                     \
+    gs_trace_scope_t GS_TRACE_CONCAT(_trace_scope_, __LINE__)                                              \
+        __attribute__((cleanup(gs_trace_scope_end))) = gs_trace_scope_begin((name), category, __FILE__, __LINE__)
+
+#define TRACE_SCOPE(name) GS_TRACE_SCOPE(name, "scope")
+#define TRACE_FUNCTION()  GS_TRACE_SCOPE(__func__, "function")
+
+#define TRACE_ENTER()                                                                                      \
+    do {                                                                                                   \
+        if (getenv("TRACE")) {                                                                             \
+            fprintf(stderr, "TRACE: Entering %s (%s:%d)\n", __func__, __FILE__, __LINE__);                 \
+        }                                                                                                  \
+    } while(0)
+
+#define LOG_VAR(var)                                                                                       \
+    do {                                                                                                   \
+        if (getenv("DEBUG")) {                                                                             \
+            fprintf(stderr, "DEBUG: %s = %d (%s:%d)\n", #var, (int)(var), __FILE__, __LINE__);             \
+        }                                                                                                  \
+    } while(0)
+
+// Buffer overflow protection testing
+#define TEST_BUFFER_OVERFLOW(buffer, size, write_size, message)                                            \
+    do {                                                                                                   \
+        gs_value_t _s = GS_VALUE(size);                                                                    \
+        gs_value_t _w = GS_VALUE(write_size);                                                              \
+        if (GS_UNLIKELY(gs_value_cmp(_w, _s) == 1)) {                                                      \
+            GS_ASSERT_FAILED(GS_FAIL_OVERFLOW, message, #write_size " <= " #size, _w, _s, _s);             \
+            return 0;                                                                                      \
+        }                                                                                                  \
+        GS_PASS("%s\n", message);                                                                          \
+    } while(0)
+
+// Allocation failure injection
+//
+// Every allocation made through gs_malloc/gs_calloc/gs_realloc/gs_strdup is counted and can be made
+// to fail. Define GLITCHSNITCH_FAULT_INJECTION before including this header to route plain
+// malloc/calloc/realloc/strdup/free in the including file through these wrappers.
+//
+// TEST_ALLOC_FAILURES(test_func, max_points, message) runs test_func in a driver process. When the
+// driver reaches allocation N (N = 1..max_points) it forks; the child sees that allocation fail and
+// runs test_func to the end while the driver carries on with the allocation succeeding. The prefix
+// before each failure point is therefore computed only once. Every failure point is reported as
+// handled, exited (e.g. through CHECK_ALLOC), LEAKED or CRASHED; the last two fail the test.
+//
+// For long stress runs, ALLOC_FAIL_RATE(rate) or GS_ALLOC_FAIL_RATE=0.001 makes each allocation fail
+// with the given probability, and ALLOC_FAIL_AT(n) reproduces a single failure point. The counters
+// are updated atomically, so the wrappers can be used from CONCURRENT_STRESS_TEST workers.
+
+typedef struct
+{
+    int  completed;     /// ? test_func returned in the child
+    long leaked;        /// ? allocations still live when it returned
+    int  status;        /// ? waitpid() status of the child
+} gs_alloc_point_t;
+
+static unsigned long      gs_alloc_seq          = 0;    /// ? allocations seen so far
+static long               gs_alloc_live         = 0;    /// ? successful allocations not yet freed
+static unsigned long      gs_alloc_fail_at      = 0;    /// ? fail exactly this allocation (0 = never)
+static double             gs_alloc_fail_rate    = -1.0; /// ? probability of failure (< 0 = read env)
+static __thread uint64_t  gs_alloc_rng          = 0;    /// ? per thread, so concurrent workers do not race on it
+static __thread unsigned int gs_alloc_rng_epoch  = 0;    /// ? gs_rng_epoch gs_alloc_rng was seeded in
+static unsigned long      gs_alloc_explore_max  = 0;    /// ? non-zero only in the driver process
+static unsigned long      gs_alloc_failed_seq   = 0;    /// ? failure point taken by this child
+static gs_alloc_point_t  *gs_alloc_points       = NULL;
+static unsigned long     *gs_alloc_points_seen  = NULL;
+
+/// ? Separate streams derived from GS_SEED, so failing allocations at random does not shift the
+/// ? sequence RANDOM_* hands to the test itself. Like the RANDOM_* streams they are numbered per
+/// ? thread, so workers fail different allocations, and RANDOM_SEED reseeds them.
+static inline double gs_alloc_random(void) {
+    if (__builtin_expect(gs_alloc_rng_epoch != __atomic_load_n(&gs_rng_epoch, __ATOMIC_RELAXED), 0)) {
+        uint64_t stream = __atomic_fetch_add(&gs_alloc_streams, 1, __ATOMIC_RELAXED);
+        gs_alloc_rng = gs_rand_seed() ^ 0xA11C0FA11ULL ^ (stream * 0xD1B54A32D192ED03ULL);
+        gs_alloc_rng_epoch = __atomic_load_n(&gs_rng_epoch, __ATOMIC_ACQUIRE);
+    }
+    return (double)(gs_splitmix64(&gs_alloc_rng) >> 11) / 9007199254740992.0;
+}
+
+static inline int gs_alloc_should_fail(void) {
+    unsigned long seq = __atomic_add_fetch(&gs_alloc_seq, 1, __ATOMIC_RELAXED);
+
+    if (seq <= gs_alloc_explore_max) {
+        fflush(stdout);
+        fflush(stderr);
+        pid_t pid = fork();
+        if (pid == 0) {
+            /// ? This child takes the failure path; every later allocation succeeds
+            gs_alloc_explore_max = 0;
+            gs_alloc_failed_seq  = seq;
+            return 1;
+        }
+        if (pid > 0) {
+            int status = 0;
+            waitpid(pid, &status, 0);
+            gs_alloc_points[seq - 1].status = status;
+            *gs_alloc_points_seen = seq;
+        }
+        return 0;
+    }
+
+    if (seq == gs_alloc_fail_at) {
+        return 1;
+    }
+    double rate;
+    __atomic_load(&gs_alloc_fail_rate, &rate, __ATOMIC_RELAXED);
+    if (rate < 0.0) {
+        const char *env = getenv("GS_ALLOC_FAIL_RATE");
+        rate = env ? atof(env) : 0.0;
+        __atomic_store(&gs_alloc_fail_rate, &rate, __ATOMIC_RELAXED);
+    }
+    return rate > 0.0 && gs_alloc_random() < rate;
+}
+
+/// ? Sampling heap profiler hooks, defined with the profiler below
+static GS_ALWAYS_INLINE void gs_heap_on_alloc(void *ptr, size_t size);
+static inline void gs_heap_on_free(void *ptr);
+
+static GS_ALWAYS_INLINE void *gs_malloc(size_t size) {
+    if (gs_alloc_should_fail()) return NULL;
+    void *ptr = malloc(size);
+    if (ptr) {
+        __atomic_add_fetch(&gs_alloc_live, 1, __ATOMIC_RELAXED);
+        gs_heap_on_alloc(ptr, size);
+    }
+    return ptr;
+}
+
+static GS_ALWAYS_INLINE void *gs_calloc(size_t count, size_t size) {
+    if (gs_alloc_should_fail()) return NULL;
+    void *ptr = calloc(count, size);
+    if (ptr) {
+        __atomic_add_fetch(&gs_alloc_live, 1, __ATOMIC_RELAXED);
+        gs_heap_on_alloc(ptr, count * size);
+    }
+    return ptr;
+}
+
+static GS_ALWAYS_INLINE void *gs_realloc(void *ptr, size_t size) {
+    if (gs_alloc_should_fail()) return NULL;
+    void *new_ptr = realloc(ptr, size);
+    if (new_ptr) {
+        if (ptr == NULL) __atomic_add_fetch(&gs_alloc_live, 1, __ATOMIC_RELAXED);
+        else gs_heap_on_free(ptr);
+        gs_heap_on_alloc(new_ptr, size);
+    }
+    return new_ptr;
+}
+
+static GS_ALWAYS_INLINE char *gs_strdup(const char *str) {
+    size_t len = strlen(str) + 1;
+    char *copy = gs_malloc(len);
+    if (copy) memcpy(copy, str, len);
+    return copy;
+}
+
+static GS_ALWAYS_INLINE void gs_free(void *ptr) {
+    if (ptr) {
+        __atomic_sub_fetch(&gs_alloc_live, 1, __ATOMIC_RELAXED);
+        gs_heap_on_free(ptr);
+    }
+    free(ptr);
+}
+
+#define ALLOC_FAIL_AT(n)                                                                                   \
+    do {                                                                                                   \
+        gs_alloc_seq     = 0;                                                                              \
+        gs_alloc_fail_at = (n);                                                                            \
+    } while(0)
+
+#define ALLOC_FAIL_RATE(rate)                                                                              \
+    do {                                                                                                   \
+        gs_alloc_fail_rate = (rate);                                                                       \
+    } while(0)
+
+/// ? Runs test_func once per failure point; returns the number of points that crashed or leaked,
+/// ? or -1 if the driver process could not be started.
+static inline int gs_alloc_failures_run(int (*test_func)(void), unsigned long max_points, const char *message) {
+    size_t map_size = sizeof(unsigned long) + max_points * sizeof(gs_alloc_point_t);
+    void *shared = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        return -1;
+    }
+    gs_alloc_points_seen = shared;
+    gs_alloc_points      = (gs_alloc_point_t *)((unsigned long *)shared + 1);
+
+    fflush(stdout);
+    fflush(stderr);
+    pid_t driver = fork();
+    if (driver == 0) {
+        gs_silence_output();
+        gs_alloc_seq         = 0;
+        gs_alloc_fail_at     = 0;
+        gs_alloc_fail_rate   = 0.0;
+        gs_alloc_explore_max = max_points;
+
+        long baseline = gs_alloc_live;
+        test_func();
+
+        if (gs_alloc_failed_seq != 0) {
+            /// ? Failure-point child: record how test_func coped before leaving
+            gs_alloc_point_t *point = &gs_alloc_points[gs_alloc_failed_seq - 1];
+            point->completed = 1;
+            point->leaked    = gs_alloc_live - baseline;
+        }
+        _exit(0);
+    } else if (driver < 0) {
+        munmap(shared, map_size);
+        return -1;
+    }
+
+    int driver_status = 0;
+    waitpid(driver, &driver_status, 0);
+
+    unsigned long seen = *gs_alloc_points_seen;
+    int bad = 0;
+    printf("ALLOC FAILURES: %s (%lu allocation points)\n", message, seen);
+    for (unsigned long i = 0; i < seen; i++) {
+        gs_alloc_point_t *point = &gs_alloc_points[i];
+        if (WIFSIGNALED(point->status)) {
+            printf("  #%-4lu CRASHED (signal %d)\n", i + 1, WTERMSIG(point->status));
+            bad++;
+        } else if (point->completed && point->leaked > 0) {
+            printf("  #%-4lu LEAKED %ld allocation(s)\n", i + 1, point->leaked);
+            bad++;
+        } else if (point->completed) {
+            printf("  #%-4lu handled\n", i + 1);
+        } else {
+            printf("  #%-4lu exited (status %d)\n", i + 1, WEXITSTATUS(point->status));
+        }
+    }
+    if (!WIFEXITED(driver_status) || WEXITSTATUS(driver_status) != 0) {
+        printf("  driver run without injected failures did not finish cleanly\n");
+        bad++;
+    }
+
+    munmap(shared, map_size);
+    gs_alloc_points      = NULL;
+    gs_alloc_points_seen = NULL;
+    return bad;
+}
+
+#define TEST_ALLOC_FAILURES(test_func, max_points, message)                                                \
+    do {                                                                                                   \
+        int _bad_points = gs_alloc_failures_run(test_func, (max_points), message);                         \
+        if (_bad_points < 0) {                                                                             \
+            fprintf(stderr, "FAIL: fork() failed for allocation failure test\n");                          \
+            return 0;                                                                                      \
+        } else if (_bad_points > 0) {                                                                      \
+            fprintf(stderr, "FAIL: %s - %d failure point(s) crashed or leaked\n", message, _bad_points);   \
+            return 0;                                                                                      \
+        } else {                                                                                           \
+            GS_PASS("%s\n", message);                                                                      \
+        }                                                                                                  \
+    } while(0)
+
+// Sampling heap profiler
+//
+// Records a stack trace for roughly one allocation per GS_HEAP_SAMPLE_BYTES allocated through the
+// gs_malloc family (see GLITCHSNITCH_FAULT_INJECTION above). The distance between samples is drawn
+// from an exponential distribution, so every byte has the same chance of being sampled and each
+// sample is scaled back up to an unbiased estimate of the bytes it stands for.
+//
+// HEAP_PROFILE_DUMP(path) writes the estimated live heap by call site in folded-stack format
+// ("main;parse;gs_malloc 1048576"), which flamegraph.pl and speedscope load directly. Setting
+// GS_HEAP_PROFILE=path starts the profiler on the first allocation, dumps on exit, and dumps again
+// whenever the process receives SIGUSR2. The signal handler only posts a semaphore; a background
+// thread writes the dump, so an idle process dumps too. Link with -rdynamic for function names.
+//
+// Each thread keeps its own countdown to the next sample, so unsampled allocations take no lock.
+// The site and sample tables are shared and guarded by a mutex, taken only when an allocation is
+// sampled or a sampled pointer is freed. A free first checks a counting filter of sampled pointers
+// with one atomic load, so frees of unsampled memory never touch the lock. Samples that do not fit
+// in the tables are counted, and the dump reports them.
+
+#define GS_HEAP_DEFAULT_INTERVAL  (512 * 1024)
+#define GS_HEAP_MAX_DEPTH         32
+#define GS_HEAP_MAX_SITES         4096
+#define GS_HEAP_MAX_SAMPLES       (1 << 16)
+#define GS_HEAP_FILTER_SLOTS      (1 << 17)
+
+typedef struct
+{
+    unsigned long long hash;
+    int                depth;
+    void              *frames[GS_HEAP_MAX_DEPTH];
+    double             live_bytes;  /// ? estimated bytes still allocated from this site
+    long               live_samples;
+} gs_heap_site_t;
+
+typedef struct
+{
+    void  *ptr;                     /// ? NULL = empty
+    int    site;
+    double weight;
+} gs_heap_sample_t;
+
+#define GS_HEAP_SLOT(ptr)        (((size_t)(ptr) >> 4) % GS_HEAP_MAX_SAMPLES)
+#define GS_HEAP_FILTER_SLOT(ptr) ((size_t)(((unsigned long long)(size_t)(ptr) * 0x9E3779B97F4A7C15ULL) >> 47))
+
+static long                  gs_heap_interval     = -1;   /// ? mean bytes between samples (0 = off, -1 = read env)
+static const char           *gs_heap_dump_path    = NULL;
+static pid_t                 gs_heap_dump_owner   = 0;    /// ? process that registered the exit dump
+static sem_t                 gs_heap_dump_request;
+static pthread_mutex_t       gs_heap_lock         = PTHREAD_MUTEX_INITIALIZER;
+static gs_heap_site_t       *gs_heap_sites        = NULL;
+static int                   gs_heap_site_count   = 0;
+static gs_heap_sample_t     *gs_heap_samples      = NULL;
+static unsigned int         *gs_heap_filter       = NULL;   /// ? sampled pointers per filter slot
+static long                  gs_heap_dropped      = 0;      /// ? samples that did not fit in the tables
+static double                gs_heap_dropped_bytes = 0.0;
+static __thread long long    gs_heap_countdown    = 0;    /// ? bytes left until this thread's next sample
+static __thread unsigned long long gs_heap_rng    = 0;    /// ? 0 until this thread's countdown is drawn
+
+/// ? Writes a printable name for a code address: the symbol when it is exported, else module+offset.
+static inline void gs_symbolize(void *addr, char *buf, size_t len) {
+#if GS_HAVE_DLADDR
+    Dl_info info = {0};
+    int found = dladdr(addr, &info) != 0;
+    if (found && info.dli_sname) {
+        snprintf(buf, len, "%s", info.dli_sname);
+    } else if (found && info.dli_fname) {
+        const char *module = strrchr(info.dli_fname, '/');
+        snprintf(buf, len, "%s+0x%lx", module ? module + 1 : info.dli_fname,
+                 (unsigned long)((char *)addr - (char *)info.dli_fbase));
+    } else {
+        snprintf(buf, len, "%p", addr);
+    }
+#else
+    snprintf(buf, len, "%p", addr);
+#endif
+}
+
+/// ? Writes "outermost;...;innermost" for a backtrace() frame list.
+static inline void gs_write_folded_stack(FILE *out, void *const *frames, int depth) {
+    char name[256];
+    for (int i = depth - 1; i >= 0; i--) {
+        /// ? Return addresses point after the call; step back into it for the right symbol
+        gs_symbolize((char *)frames[i] - (i > 0 ? 1 : 0), name, sizeof(name));
+        for (char *c = name; *c; c++) {
+            if (*c == ';' || *c == ' ') *c = '_';
+        }
+        fprintf(out, "%s%s", name, i > 0 ? ";" : "");
+    }
+}
+
+static inline long long gs_heap_next_countdown(void) {
+    if (gs_heap_rng == 0) {
+        gs_heap_rng = 0x2545F4914F6CDD1DULL ^ ((unsigned long long)getpid() << 32) ^
+                      (unsigned long long)syscall(SYS_gettid);
+    }
+    gs_heap_rng ^= gs_heap_rng << 13;
+    gs_heap_rng ^= gs_heap_rng >> 7;
+    gs_heap_rng ^= gs_heap_rng << 17;
+    double u = ((double)(gs_heap_rng >> 11) + 0.5) / 9007199254740992.0;
+    return (long long)(-log(u) * (double)__atomic_load_n(&gs_heap_interval, __ATOMIC_RELAXED)) + 1;
+}
+
+static inline void gs_heap_signal_handler(int sig) {
+    (void)sig;
+    sem_post(&gs_heap_dump_request);    /// ? async-signal-safe; the dump itself is not
+}
+
+static inline void gs_heap_dump(const char *path);
+
+static inline void gs_heap_dump_at_exit(void) {
+    /// ? Forked children inherit the handler; their exit must not overwrite the parent's profile
+    if (getpid() == gs_heap_dump_owner) {
+        gs_heap_dump(gs_heap_dump_path);
+    }
+}
+
+static void *gs_heap_dump_thread(void *arg) {
+    (void)arg;
+    for (;;) {
+        if (sem_wait(&gs_heap_dump_request) == 0) {
+            gs_heap_dump(gs_heap_dump_path);
+        }
+    }
+    return NULL;
+}
+
+/// ? Call with gs_heap_lock held.
+static inline void gs_heap_start_locked(long interval) {
+    if (gs_heap_sites == NULL) {
+        gs_heap_sites   = calloc(GS_HEAP_MAX_SITES, sizeof(gs_heap_site_t));
+        gs_heap_samples = calloc(GS_HEAP_MAX_SAMPLES, sizeof(gs_heap_sample_t));
+        gs_heap_filter  = calloc(GS_HEAP_FILTER_SLOTS, sizeof(unsigned int));
+        if (gs_heap_sites == NULL || gs_heap_samples == NULL || gs_heap_filter == NULL) {
+            fprintf(stderr, "WARNING: heap profiler disabled, could not allocate its tables\n");
+            __atomic_store_n(&gs_heap_interval, 0, __ATOMIC_RELEASE);
+            return;
+        }
+    }
+    __atomic_store_n(&gs_heap_interval, interval > 0 ? interval : GS_HEAP_DEFAULT_INTERVAL, __ATOMIC_RELEASE);
+    gs_heap_countdown = gs_heap_next_countdown();
+}
+
+static inline void gs_heap_start(long interval) {
+    pthread_mutex_lock(&gs_heap_lock);
+    gs_heap_start_locked(interval);
+    pthread_mutex_unlock(&gs_heap_lock);
+}
+
+static inline void gs_heap_start_from_env(void) {
+    pthread_mutex_lock(&gs_heap_lock);
+    if (__atomic_load_n(&gs_heap_interval, __ATOMIC_ACQUIRE) >= 0) {
+        pthread_mutex_unlock(&gs_heap_lock);     /// ? another thread got here first
+        return;
+    }
+    gs_heap_dump_path = getenv("GS_HEAP_PROFILE");
+    if (gs_heap_dump_path == NULL) {
+        __atomic_store_n(&gs_heap_interval, 0, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&gs_heap_lock);
+        return;
+    }
+    const char *interval = getenv("GS_HEAP_SAMPLE_BYTES");
+    gs_heap_start_locked(interval ? atol(interval) : 0);
+    pthread_mutex_unlock(&gs_heap_lock);
+    if (gs_heap_interval > 0) {
+        /// ? The dump thread blocks every signal, so SIGUSR2 and SIGPROF go to the threads under test
+        pthread_t thread;
+        sigset_t all, previous;
+        sigfillset(&all);
+        sem_init(&gs_heap_dump_request, 0, 0);
+        pthread_sigmask(SIG_SETMASK, &all, &previous);
+        int started = pthread_create(&thread, NULL, gs_heap_dump_thread, NULL) == 0;
+        pthread_sigmask(SIG_SETMASK, &previous, NULL);
+        if (started) {
+            pthread_detach(thread);
+            struct sigaction action;
+            memset(&action, 0, sizeof(action));
+            action.sa_handler = gs_heap_signal_handler;
+            action.sa_flags   = SA_RESTART;
+            sigaction(SIGUSR2, &action, NULL);
+        }
+        gs_heap_dump_owner = getpid();
+        atexit(gs_heap_dump_at_exit);
+    }
+}
+
+static __attribute__((noinline)) void gs_heap_record(void *ptr, size_t size) {
+    int drawn = gs_heap_rng != 0;
+    gs_heap_countdown = gs_heap_next_countdown();
+    if (!drawn) {
+        return;     /// ? a thread's first countdown starts at its first allocation, not at 0
+    }
+
+    void *frames[GS_HEAP_MAX_DEPTH + 1];
+    int depth = backtrace(frames, GS_HEAP_MAX_DEPTH + 1) - 1;   /// ? drop gs_heap_record itself
+    if (depth <= 0) {
+        return;
+    }
+
+    unsigned long long hash = 1469598103934665603ULL;
+    for (int i = 1; i <= depth; i++) {
+        hash = (hash ^ (unsigned long long)(size_t)frames[i]) * 1099511628211ULL;
+    }
+
+    /// ? Each sampled byte range of this size stands for size / P(sampled) bytes
+    double weight = (double)size / (1.0 - exp(-(double)size / (double)gs_heap_interval));
+
+    pthread_mutex_lock(&gs_heap_lock);
+    int site = (int)(hash % GS_HEAP_MAX_SITES);
+    for (int probes = 0; ; probes++) {
+        if (probes == GS_HEAP_MAX_SITES) {
+            site = -1;
+            break;
+        }
+        gs_heap_site_t *entry = &gs_heap_sites[site];
+        if (entry->depth == 0) {
+            entry->hash  = hash;
+            entry->depth = depth;
+            memcpy(entry->frames, frames + 1, depth * sizeof(void *));
+            gs_heap_site_count++;
+            break;
+        }
+        /// ? Equal hashes are not enough: two call sites must never be merged
+        if (entry->hash == hash && entry->depth == depth &&
+            memcmp(entry->frames, frames + 1, depth * sizeof(void *)) == 0) {
+            break;
+        }
+        site = (site + 1) % GS_HEAP_MAX_SITES;
+    }
+
+    size_t slot = GS_HEAP_SLOT(ptr);
+    int stored = 0;
+    for (int probes = 0; site >= 0 && probes < GS_HEAP_MAX_SAMPLES; probes++) {
+        if (gs_heap_samples[slot].ptr == NULL) {
+            gs_heap_samples[slot].ptr    = ptr;
+            gs_heap_samples[slot].site   = site;
+            gs_heap_samples[slot].weight = weight;
+            gs_heap_sites[site].live_bytes += weight;
+            gs_heap_sites[site].live_samples++;
+            __atomic_add_fetch(&gs_heap_filter[GS_HEAP_FILTER_SLOT(ptr)], 1, __ATOMIC_RELEASE);
+            stored = 1;
+            break;
+        }
+        slot = (slot + 1) % GS_HEAP_MAX_SAMPLES;
+    }
+    if (!stored) {
+        gs_heap_dropped++;
+        gs_heap_dropped_bytes += weight;
+    }
+    pthread_mutex_unlock(&gs_heap_lock);
+}
+
+static GS_ALWAYS_INLINE void gs_heap_on_alloc(void *ptr, size_t size) {
+    long interval = __atomic_load_n(&gs_heap_interval, __ATOMIC_ACQUIRE);
+    if (GS_UNLIKELY(interval < 0)) {
+        gs_heap_start_from_env();
+        interval = __atomic_load_n(&gs_heap_interval, __ATOMIC_ACQUIRE);
+    }
+    if (interval == 0) {
+        return;
+    }
+    gs_heap_countdown -= (long long)size;
+    if (GS_UNLIKELY(gs_heap_countdown <= 0)) {
+        gs_heap_record(ptr, size);
+    }
+}
+
+/// ? Empties a slot by shifting later entries of its probe run back, so no tombstones build up and
+/// ? a free of an unsampled pointer stops at the first empty slot even after hours of churn.
+static inline void gs_heap_remove_slot(size_t hole) {
+    size_t next = hole;
+    for (;;) {
+        next = (next + 1) % GS_HEAP_MAX_SAMPLES;
+        if (gs_heap_samples[next].ptr == NULL) {
+            break;
+        }
+        /// ? An entry may only move back if its home slot does not lie between the hole and itself
+        size_t home = GS_HEAP_SLOT(gs_heap_samples[next].ptr);
+        int stays = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+        if (!stays) {
+            gs_heap_samples[hole] = gs_heap_samples[next];
+            hole = next;
+        }
+    }
+    gs_heap_samples[hole].ptr = NULL;
+}
+
+static inline void gs_heap_on_free(void *ptr) {
+    if (__atomic_load_n(&gs_heap_interval, __ATOMIC_ACQUIRE) <= 0) {
+        return;
+    }
+    /// ? Zero means no sampled pointer hashes here; the pointer reached this thread through some
+    /// ? synchronisation after gs_heap_record, so the acquire load sees its increment
+    unsigned int *filter = &gs_heap_filter[GS_HEAP_FILTER_SLOT(ptr)];
+    if (__atomic_load_n(filter, __ATOMIC_ACQUIRE) == 0) {
+        return;
+    }
+    pthread_mutex_lock(&gs_heap_lock);
+    size_t slot = GS_HEAP_SLOT(ptr);
+    for (int probes = 0; probes < GS_HEAP_MAX_SAMPLES && gs_heap_samples[slot].ptr != NULL; probes++) {
+        if (gs_heap_samples[slot].ptr == ptr) {
+            gs_heap_site_t *site = &gs_heap_sites[gs_heap_samples[slot].site];
+            site->live_bytes -= gs_heap_samples[slot].weight;
+            site->live_samples--;
+            gs_heap_remove_slot(slot);
+            __atomic_sub_fetch(filter, 1, __ATOMIC_RELEASE);
+            break;
+        }
+        slot = (slot + 1) % GS_HEAP_MAX_SAMPLES;
+    }
+    pthread_mutex_unlock(&gs_heap_lock);
+}
+
+/// ? Writes live heap by call site in folded-stack format; NULL or "-" writes to stdout.
+static inline void gs_heap_dump(const char *path) {
+    if (gs_heap_sites == NULL) {
+        return;
+    }
+    int to_stdout = path == NULL || strcmp(path, "-") == 0;
+    FILE *out = to_stdout ? stdout : fopen(path, "w");
+    if (out == NULL) {
+        fprintf(stderr, "WARNING: could not write heap profile '%s': %s\n", path, strerror(errno));
+        return;
+    }
+
+    double total = 0.0;
+    int sites = 0;
+    pthread_mutex_lock(&gs_heap_lock);
+    for (int i = 0; i < GS_HEAP_MAX_SITES; i++) {
+        gs_heap_site_t *site = &gs_heap_sites[i];
+        if (site->depth == 0 || site->live_samples <= 0) {
+            continue;
+        }
+        gs_write_folded_stack(out, site->frames, site->depth);
+        fprintf(out, " %.0f\n", site->live_bytes);
+        total += site->live_bytes;
+        sites++;
+    }
+    long dropped = gs_heap_dropped;
+    double dropped_bytes = gs_heap_dropped_bytes;
+    pthread_mutex_unlock(&gs_heap_lock);
+
+    if (to_stdout) {
+        fflush(out);
+    } else {
+        fclose(out);
+    }
+    fprintf(stderr, "HEAP PROFILE: ~%.0f bytes live across %d call sites -> %s",
+            total, sites, to_stdout ? "stdout" : path);
+    if (dropped > 0) {
+        fprintf(stderr, " (%ld samples, ~%.0f bytes, dropped; tables hold %d sites and %d samples)",
+                dropped, dropped_bytes, GS_HEAP_MAX_SITES, GS_HEAP_MAX_SAMPLES);
+    }
+    fprintf(stderr, "\n");
+}
+
+#define HEAP_PROFILE_START(sample_bytes)                                                                   \
+    do {                                                                                                   \
+        gs_heap_start(sample_bytes);                                                                       \
+    } while(0)
+
+#define HEAP_PROFILE_DUMP(path)                                                                            \
+    do {                                                                                                   \
+        gs_heap_dump(path);                                                                                \
+    } while(0)
+
+// Trace export
+//
+// TRACE_EXPORT(path) writes every recorded span as a Chrome trace-event "X" (complete) event, plus
+// a thread_name metadata event per thread. Timestamps are microseconds on CLOCK_MONOTONIC.
+//
+// Define GLITCHSNITCH_INSTRUMENT_FUNCTIONS and compile with -finstrument-functions to get a span for
+// every function call without annotating anything. Add
+// -finstrument-functions-exclude-file-list=glitchsnitch.h so the header's own helpers are skipped,
+// and link with -rdynamic so dladdr() can name the executable's non-static functions.
+
+static inline void gs_trace_json_string(FILE *out, const char *text) {
+    fputc('"', out);
+    for (const unsigned char *c = (const unsigned char *)text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(out, "\\%c", *c);
+        } else if (*c < 0x20) {
+            fprintf(out, "\\u%04x", *c);
+        } else {
+            fputc(*c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+/// ? Writes all recorded spans to path as Chrome trace-event JSON; returns the number of events.
+static inline GS_NO_INSTRUMENT long gs_trace_export(const char *path) {
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+        fprintf(stderr, "WARNING: cannot write trace '%s': %s\n", path, strerror(errno));
+        return -1;
+    }
+    long pid = (long)getpid();
+    long events = 0, dropped = 0;
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for (gs_trace_buffer_t *buffer = __atomic_load_n(&gs_trace_buffers, __ATOMIC_ACQUIRE); buffer; buffer = buffer->next) {
+        fprintf(out, "%s\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%ld,\"tid\":%ld,\"args\":{\"name\":",
+                events ? "," : "", pid, buffer->tid);
+        gs_trace_json_string(out, buffer->thread_name);
+        fprintf(out, "}}");
+        events++;
+        int count = __atomic_load_n(&buffer->count, __ATOMIC_ACQUIRE);
+        for (int i = 0; i < count; i++) {
+            const gs_trace_event_t *event = &buffer->events[i];
+            char symbol[256];
+            const char *name = event->name;
+            if (name == NULL) {
+                gs_symbolize((void *)event->addr, symbol, sizeof(symbol));
+                name = symbol;
+            }
+            fprintf(out, ",\n{\"ph\":\"X\",\"name\":");
+            gs_trace_json_string(out, name);
+            fprintf(out, ",\"cat\":\"%s\",\"pid\":%ld,\"tid\":%ld,\"ts\":%.3f,\"dur\":%.3f}",
+                    event->category, pid, buffer->tid, event->start_ns / 1e3, event->duration_ns / 1e3);
+            events++;
+        }
+        dropped += buffer->dropped;
+    }
+    fprintf(out, "\n]}\n");
+    fclose(out);
+    fprintf(stderr, "TRACE: %ld events -> %s", events, path);
+    if (dropped > 0) {
+        fprintf(stderr, " (%ld spans dropped; buffers hold %d per thread)", dropped, GS_TRACE_EVENTS);
+    }
+    fprintf(stderr, "\n");
+    return events;
+}
+
+static GS_NO_INSTRUMENT void gs_trace_export_at_exit(void) {
+    /// ? Forked children (crash tests, fuzz workers, ...) inherit the handler but not the trace
+    if (getpid() != gs_trace_owner) {
+        return;
+    }
+    const char *path = getenv("GS_TRACE_FILE");
+    if (path && *path) {
+        gs_trace_export(path);
+    }
+}
+
+#define TRACE_START()                                                                                      \
+    do {                                                                                                   \
+        gs_trace_start();                                                                                  \
+    } while(0)
+
+#define TRACE_EXPORT(path)                                                                                 \
+    do {                                                                                                   \
+        gs_trace_export(path);                                                                             \
+    } while(0)
+
+#ifdef GLITCHSNITCH_INSTRUMENT_FUNCTIONS
+#define GS_TRACE_CALL_DEPTH 256
+
+static __thread uint64_t gs_trace_call_start[GS_TRACE_CALL_DEPTH];
+static __thread int      gs_trace_call_depth = 0;
+
+__attribute__((weak)) GS_NO_INSTRUMENT void __cyg_profile_func_enter(void *fn, void *call_site) {
+    (void)fn;
+    (void)call_site;
+    if (gs_trace_call_depth < GS_TRACE_CALL_DEPTH) {
+        gs_trace_call_start[gs_trace_call_depth] = gs_trace_enabled() ? gs_trace_now() : 0;
+    }
+    gs_trace_call_depth++;
+}
+
+__attribute__((weak)) GS_NO_INSTRUMENT void __cyg_profile_func_exit(void *fn, void *call_site) {
+    (void)call_site;
+    if (gs_trace_call_depth <= 0) {
+        return;
+    }
+    gs_trace_call_depth--;
+    if (gs_trace_call_depth < GS_TRACE_CALL_DEPTH && gs_trace_call_start[gs_trace_call_depth] != 0) {
+        gs_trace_record(NULL, "call", fn, gs_trace_call_start[gs_trace_call_depth], gs_trace_now());
+    }
+}
+#endif
+
+// Sampling CPU profiler
+//
+// PROFILE_START() arms setitimer(ITIMER_PROF), which raises SIGPROF after every 1/GS_PROFILE_HZ
+// seconds of CPU time used by any thread of the process (default 1000 Hz). The handler copies the
+// interrupted thread's stack with backtrace() into a sample buffer that is mapped up front, claiming
+// its slot with an atomic increment, so it neither locks nor allocates; ticks beyond
+// GS_PROFILE_SAMPLES are counted as dropped. backtrace() is called once before the timer is first
+// armed, since its first call loads libgcc. The kernel checks the timer on its scheduler tick, so
+// the effective rate may be capped at CONFIG_HZ (often 250 Hz). A sample costs a few microseconds;
+// PROFILE_STOP reports the measured handler time as a share of the CPU time profiled.
+//
+// PROFILE_STOP(name) disarms the timer, writes GS_PROFILE_DIR/name.folded (default directory ".")
+// in the folded-stack format flamegraph.pl and speedscope load, and prints the functions with the
+// most self samples. With GS_PROFILE=1 every BENCHMARK_START/END pair and every RUN_SLOW_TEST is
+// profiled the same way. One profile runs at a time, so a benchmark inside a profiled slow test is
+// part of the test's profile. Link with -rdynamic for function names.
+
+#define GS_PROFILE_DEFAULT_HZ  1000
+#define GS_PROFILE_DEPTH       48
+#define GS_PROFILE_SAMPLES     (1 << 15)
+#define GS_PROFILE_TOP         10
+#define GS_PROFILE_SKIP        2        /// ? the handler and the kernel's signal return trampoline
+
+typedef struct
+{
+    int   depth;
+    void *frames[GS_PROFILE_DEPTH];
+} gs_profile_sample_t;
+
+typedef struct
+{
+    char name[128];
+    long samples;
+} gs_profile_symbol_t;
+
+typedef struct
+{
+    char *folded;
+    long  samples;
+} gs_profile_stack_t;
+
+static gs_profile_sample_t  *gs_profile_samples    = NULL;
+static volatile sig_atomic_t gs_profile_active     = 0;
+static int                   gs_profile_requested  = -1;   /// ? GS_PROFILE, -1 until read
+static long                  gs_profile_ticks      = 0;    /// ? including dropped ones
+static uint64_t              gs_profile_handler_ns = 0;
+static long                  gs_profile_hz         = GS_PROFILE_DEFAULT_HZ;
+static struct rusage         gs_profile_usage;
+
+static GS_NO_INSTRUMENT void gs_profile_handler(int sig) {
+    (void)sig;
+    if (!gs_profile_active) {
+        return;
+    }
+    int saved_errno = errno;
+    uint64_t start = gs_trace_now();
+    long index = __atomic_fetch_add(&gs_profile_ticks, 1, __ATOMIC_RELAXED);
+    if (index < GS_PROFILE_SAMPLES) {
+        void *frames[GS_PROFILE_DEPTH + GS_PROFILE_SKIP];
+        int depth = backtrace(frames, GS_PROFILE_DEPTH + GS_PROFILE_SKIP) - GS_PROFILE_SKIP;
+        gs_profile_sample_t *sample = &gs_profile_samples[index];
+        if (depth > 0) {
+            memcpy(sample->frames, frames + GS_PROFILE_SKIP, (size_t)depth * sizeof(void *));
+        }
+        __atomic_store_n(&sample->depth, depth > 0 ? depth : 0, __ATOMIC_RELEASE);
+    }
+    __atomic_fetch_add(&gs_profile_handler_ns, gs_trace_now() - start, __ATOMIC_RELAXED);
+    errno = saved_errno;
+}
+
+/// ? Whether GS_PROFILE asks for benchmarks and slow tests to be profiled.
+static inline int gs_profile_wanted(void) {
+    if (gs_profile_requested < 0) {
+        const char *value = getenv("GS_PROFILE");
+        gs_profile_requested = value && *value && strcmp(value, "0") != 0;
+    }
+    return gs_profile_requested;
+}
+
+/// ? Starts sampling; returns 0 if a profile is already running or sampling cannot be set up.
+static inline int gs_profile_start(void) {
+    if (gs_profile_active) {
+        return 0;
+    }
+    if (gs_profile_samples == NULL) {
+        void *map = mmap(NULL, GS_PROFILE_SAMPLES * sizeof(gs_profile_sample_t), PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map == MAP_FAILED) {
+            fprintf(stderr, "WARNING: profiler disabled, could not map its sample buffer\n");
+            return 0;
+        }
+        gs_profile_samples = map;
+
+        void *prime[GS_PROFILE_SKIP];
+        backtrace(prime, GS_PROFILE_SKIP);
+
+        /// ? The handler stays installed: a tick still pending after the timer is disarmed would
+        /// ? otherwise get SIGPROF's default action and terminate the process
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = gs_profile_handler;
+        action.sa_flags   = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGPROF, &action, NULL);
+    }
+
+    const char *hz = getenv("GS_PROFILE_HZ");
+    gs_profile_hz = hz && atol(hz) > 0 ? atol(hz) : GS_PROFILE_DEFAULT_HZ;
+    if (gs_profile_hz > 1000000) {
+        gs_profile_hz = 1000000;
+    }
+    gs_profile_ticks      = 0;
+    gs_profile_handler_ns = 0;
+    getrusage(RUSAGE_SELF, &gs_profile_usage);
+    gs_profile_active = 1;
+
+    struct itimerval timer;
+    timer.it_interval.tv_sec  = 0;
+    timer.it_interval.tv_usec = 1000000 / gs_profile_hz;
+    timer.it_value            = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+        gs_profile_active = 0;
+        fprintf(stderr, "WARNING: profiler disabled, cannot arm ITIMER_PROF: %s\n", strerror(errno));
+        return 0;
+    }
+    return 1;
+}
+
+static inline int gs_profile_compare(const void *a, const void *b) {
+    const gs_profile_sample_t *x = &gs_profile_samples[*(const int *)a];
+    const gs_profile_sample_t *y = &gs_profile_samples[*(const int *)b];
+    if (x->depth != y->depth) {
+        return x->depth < y->depth ? -1 : 1;
+    }
+    return memcmp(x->frames, y->frames, (size_t)x->depth * sizeof(void *));
+}
+
+static inline int gs_profile_compare_symbols(const void *a, const void *b) {
+    long x = ((const gs_profile_symbol_t *)a)->samples;
+    long y = ((const gs_profile_symbol_t *)b)->samples;
+    return (x < y) - (x > y);
+}
+
+static inline int gs_profile_compare_stacks(const void *a, const void *b) {
+    return strcmp(((const gs_profile_stack_t *)a)->folded, ((const gs_profile_stack_t *)b)->folded);
+}
+
+/// ? Stops sampling, writes name.folded and prints the top functions by self samples.
+static inline void gs_profile_stop(const char *name) {
+    if (!gs_profile_active) {
+        return;
+    }
+    struct itimerval off;
+    memset(&off, 0, sizeof(off));
+    setitimer(ITIMER_PROF, &off, NULL);
+    gs_profile_active = 0;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double cpu_ms = gs_timeval_ms(usage.ru_utime) - gs_timeval_ms(gs_profile_usage.ru_utime) +
+                    gs_timeval_ms(usage.ru_stime) - gs_timeval_ms(gs_profile_usage.ru_stime);
+    long ticks = __atomic_load_n(&gs_profile_ticks, __ATOMIC_RELAXED);
+    int taken = ticks < GS_PROFILE_SAMPLES ? (int)ticks : GS_PROFILE_SAMPLES;
+
+    /// ? Group identical raw stacks first, so each distinct stack is symbolized once
+    int *order = malloc((taken ? (size_t)taken : 1) * sizeof(int));
+    gs_profile_stack_t *stacks = calloc(taken ? (size_t)taken : 1, sizeof(gs_profile_stack_t));
+    gs_profile_symbol_t *symbols = calloc(taken ? (size_t)taken : 1, sizeof(gs_profile_symbol_t));
+    if (order == NULL || stacks == NULL || symbols == NULL) {
+        fprintf(stderr, "WARNING: cannot report profile '%s', out of memory\n", name);
+        free(order);
+        free(stacks);
+        free(symbols);
+        return;
+    }
+    int recorded = 0;
+    for (int i = 0; i < taken; i++) {
+        if (__atomic_load_n(&gs_profile_samples[i].depth, __ATOMIC_ACQUIRE) > 0) {
+            order[recorded++] = i;
+        }
+    }
+    qsort(order, (size_t)recorded, sizeof(int), gs_profile_compare);
+
+    int stack_count = 0, symbol_count = 0;
+    for (int run = 0; run < recorded; ) {
+        int next = run + 1;
+        while (next < recorded && gs_profile_compare(&order[run], &order[next]) == 0) {
+            next++;
+        }
+        const gs_profile_sample_t *sample = &gs_profile_samples[order[run]];
+        size_t size = 0;
+        FILE *text = open_memstream(&stacks[stack_count].folded, &size);
+        if (text) {
+            gs_write_folded_stack(text, sample->frames, sample->depth);
+            fclose(text);
+            stacks[stack_count++].samples = next - run;
+        }
+
+        /// ? The innermost frame is the interrupted instruction itself, so it needs no adjustment
+        char leaf[sizeof(symbols[0].name)];
+        gs_symbolize(sample->frames[0], leaf, sizeof(leaf));
+        int s = 0;
+        while (s < symbol_count && strcmp(symbols[s].name, leaf) != 0) {
+            s++;
+        }
+        if (s == symbol_count) {
+            memcpy(symbols[s].name, leaf, sizeof(leaf));
+            symbol_count++;
+        }
+        symbols[s].samples += next - run;
+        run = next;
+    }
+    for (int i = 0; i < taken; i++) {
+        gs_profile_samples[i].depth = 0;
+    }
+
+    /// ? Different addresses in one function fold to the same text; merge those lines
+    const char *dir = getenv("GS_PROFILE_DIR");
+    char path[1024];
+    int length = snprintf(path, sizeof(path), "%s/", dir && *dir ? dir : ".");
+    for (const char *c = name; *c && length < (int)sizeof(path) - 8; c++) {
+        path[length++] = (*c == '/' || *c == ' ') ? '_' : *c;
+    }
+    snprintf(path + length, sizeof(path) - (size_t)length, ".folded");
+    gs_mkdir_parents(path);
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+        fprintf(stderr, "WARNING: cannot write profile '%s': %s\n", path, strerror(errno));
+    }
+    qsort(stacks, (size_t)stack_count, sizeof(gs_profile_stack_t), gs_profile_compare_stacks);
+    for (int run = 0; run < stack_count; ) {
+        long samples = 0;
+        int next = run;
+        while (next < stack_count && strcmp(stacks[run].folded, stacks[next].folded) == 0) {
+            samples += stacks[next++].samples;
+        }
+        if (out) {
+            fprintf(out, "%s %ld\n", stacks[run].folded, samples);
+        }
+        run = next;
+    }
+    if (out) {
+        fclose(out);
+    }
+
+    qsort(symbols, (size_t)symbol_count, sizeof(gs_profile_symbol_t), gs_profile_compare_symbols);
+    printf("PROFILE: %s - %d samples in %.1f ms of CPU (%ld Hz requested), sampling overhead %.2f%% -> %s\n",
+           name, recorded, cpu_ms, gs_profile_hz, cpu_ms > 0 ? gs_profile_handler_ns / 1e4 / cpu_ms : 0.0,
+           out ? path : "(not written)");
+    if (ticks > taken) {
+        printf("  %ld ticks dropped; the buffer holds %d samples\n", ticks - taken, GS_PROFILE_SAMPLES);
+    }
+    if (symbol_count > 0) {
+        printf("  %6s %8s  %s\n", "self%", "samples", "function");
+    }
+    for (int s = 0; s < symbol_count && s < GS_PROFILE_TOP; s++) {
+        printf("  %5.1f%% %8ld  %s\n", 100.0 * symbols[s].samples / recorded, symbols[s].samples, symbols[s].name);
+    }
+    for (int i = 0; i < stack_count; i++) {
+        free(stacks[i].folded);
+    }
+    free(order);
+    free(stacks);
+    free(symbols);
+}
+
+#define PROFILE_START()                                                                                    \
+    do {                                                                                                   \
+        gs_profile_start();                                                                                \
+    } while(0)
+
+#define PROFILE_STOP(name)                                                                                 \
+    do {                                                                                                   \
+        gs_profile_stop(name);                                                                             \
+    } while(0)
+
+/// ? RUN_TEST for a test flagged slow: profiled when GS_PROFILE is set
+#define RUN_SLOW_TEST(test_func)                                                                           \
+    do {                                                                                                   \
+        int _profiling = gs_profile_wanted() && gs_profile_start();                                        \
+        RUN_TEST(test_func);                                                                               \
+        if (_profiling) {                                                                                  \
+            gs_profile_stop(#test_func);                                                                   \
+        }                                                                                                  \
+    } while(0)
+
+// Route the including file's allocations through the fault-injection wrappers.
+// This block has to stay at the end of the header so the wrappers above still see the real allocator.
+#ifdef GLITCHSNITCH_FAULT_INJECTION
+#define malloc(size)        gs_malloc(size)
+#define calloc(count, size) gs_calloc(count, size)
+#define realloc(ptr, size)  gs_realloc(ptr, size)
+#define strdup(str)         gs_strdup(str)
+#define free(ptr)           gs_free(ptr)
+#endif